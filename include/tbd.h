@@ -36,16 +36,30 @@ namespace tbd
 #include "tbd/bit.h"
 // bit processing streams
 #include "tbd/bitstream.h"
+// variable length bit codes
+#include "tbd/bitcodec.h"
+// compile time bit layouts of records
+#include "tbd/bitlayout.h"
+// canonical Huffman code for bit streams
+#include "tbd/huffman.h"
 // document object model (DOM) stream base classes
 #include "tbd/domstream.h"
+// DOM node memory pools
+#include "tbd/domarena.h"
+// interned names of DOM nodes
+#include "tbd/domsymbols.h"
 // dumping tools
 #include "tbd/dump.h"
 // exception base class
 #include "tbd/exception.h"
 // large file streams
 #include "tbd/filestream.h"
+// asynchronous file output stream
+#include "tbd/asyncfilestream.h"
 // memory streams
 #include "tbd/memstream.h"
+// memory mapped file streams
+#include "tbd/mmapstream.h"
 // network tools
 #include "tbd/network.h"
 // NUL stream
@@ -0,0 +1,323 @@
+///////////////////////////////////////////////////////////////////////////////
+/// @file asyncfilestream.h
+/// @brief File output stream that writes in a background thread
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TBD__ASYNCFILESTREAM_H
+#define __TBD__ASYNCFILESTREAM_H
+
+#include "stream.h"
+#include "filestream.h"
+
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace tbd
+{
+  /** @brief File output stream that hands its data to a writer thread.
+   *  @details
+   *  Written data is collected in one of a fixed number of buffers. Filled
+   *  buffers are queued in a ring and written to the file by a dedicated
+   *  thread, so the producer (e.g. a BitOStream or BinOStream) doesn't wait
+   *  for the disk. The memory used is bounded by the number of buffers times
+   *  their size. If all buffers are queued the producer either waits
+   *  (BP_BLOCK) or the write fails (BP_FAIL).
+   *  @n flush() only queues the current buffer. Use wait() to wait until
+   *  all data has been written or sync() as durability barrier which
+   *  additionally commits the data to the disk.
+   *  @attention Use an instance from one producer thread only.
+   *  @ingroup FileStreams
+   */
+  class AsyncFileOStream
+    : virtual public FileStreamBase
+    , public OStream<huge_streampos>
+  {
+    IMPLEMENT_OSTREAM_OPERATORS(AsyncFileOStream,huge_streampos);
+  public:
+    typedef huge_streampos streampos;
+    /// @brief What to do when all buffers are queued.
+    enum Backpressure
+    {
+      /// @brief wait until the writer thread frees a buffer
+      BP_BLOCK,
+      /// @brief let the write fail (see fail())
+      BP_FAIL
+    };
+    /** @brief Constructor
+     *  @param unBufferSize Size of each buffer.
+     *  @param unBuffers Number of buffers.
+     *  @param eBackpressure What to do when all buffers are queued.
+     */
+    AsyncFileOStream( size_t unBufferSize=1024*1024, size_t unBuffers=4, Backpressure eBackpressure=BP_BLOCK )
+    { init(unBufferSize,unBuffers,eBackpressure); }
+    /** @brief Constructor opening a file
+     *  @param rcFilename Name of the file to open.
+     *  @param bAppend If true, output will be appended to an existing file.
+     *  @param unBufferSize Size of each buffer.
+     *  @param unBuffers Number of buffers.
+     *  @param eBackpressure What to do when all buffers are queued.
+     */
+    AsyncFileOStream( const std::string& rcFilename, bool bAppend=false, size_t unBufferSize=1024*1024, size_t unBuffers=4, Backpressure eBackpressure=BP_BLOCK )
+    {
+      init(unBufferSize,unBuffers,eBackpressure);
+      open(rcFilename,bAppend);
+    }
+    /// @brief Destructor writes all queued data and closes the file.
+    ~AsyncFileOStream()
+    {
+      close();
+      for( size_t i=0; i<m_blocks.size(); i++ )
+        delete[] m_blocks[i].m_pch;
+    }
+    /// @brief Opens a file and starts the writer thread.
+    void open( const std::string& rcFilename, bool bAppend=false )
+    {
+      FileStreamBase::open(rcFilename,bAppend?OM_APPEND:OM_WRITEONLY,_S_IWRITE);
+      if( !FileStreamBase::is_open() )
+        return;
+      m_nPos = m_nWriterPos = FileStreamBase::tell();
+      m_bFailed = false;
+      m_bStop = false;
+      m_unHead = m_unTail = m_unQueued = 0;
+      m_bCurrent = false;
+      m_thread = boost::thread(&AsyncFileOStream::run,this);
+    }
+    /// @brief Writes all queued data, stops the writer thread and closes the
+    ///        file.
+    void close()
+    {
+      if( !FileStreamBase::is_open() )
+        return;
+      flush();
+      {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_bStop = true;
+      }
+      m_condWork.notify_one();
+      m_thread.join();
+      FileStreamBase::close();
+    }
+    virtual bool is_open() const { return FileStreamBase::is_open(); }
+    /** @brief Write size bytes from pch into this stream.
+     *  @param pch Pointer to the content to write.
+     *  @param size Size of the content.
+     */
+    virtual void write( const char* pch, size_t size )
+    {
+      if( !is_open() )
+      {
+        BOOST_ASSERT(0);
+        return;
+      }
+      while( 0 != size )
+      {
+        if( !m_bCurrent && !acquire() )
+          return;
+        Block& block = m_blocks[m_unTail];
+        size_t unCopy = std::min(size,m_unBufferSize-block.m_unFill);
+        ::memcpy(block.m_pch+block.m_unFill,pch,unCopy);
+        block.m_unFill += unCopy;
+        pch += unCopy;
+        size -= unCopy;
+        m_nPos += unCopy;
+        if( block.m_unFill == m_unBufferSize )
+          submit();
+      }
+    }
+    /// @brief Returns the current write position.
+    virtual streampos tellp() const { return m_nPos; }
+    /// @brief Sets the current write position.
+    /// @attention Not possible in append mode.
+    virtual void seekp(const streampos& p)
+    {
+      BOOST_ASSERT(OM_APPEND != mode());
+      // the next buffer starts at the new position
+      flush();
+      m_nPos = p;
+    }
+    virtual void seekp2end()
+    {
+      // wait for all data to know the end of the file
+      wait();
+      FileStreamBase::seek(0,ORG_END);
+      m_nPos = m_nWriterPos = FileStreamBase::tell();
+    }
+    /// @brief Hands the current buffer to the writer thread without waiting.
+    virtual void flush()
+    {
+      if( m_bCurrent && 0 < m_blocks[m_unTail].m_unFill )
+        submit();
+    }
+    /// @brief Waits until all data has been written to the file.
+    /// @return false if writing failed.
+    bool wait()
+    {
+      flush();
+      boost::mutex::scoped_lock lock(m_mutex);
+      while( 0 < m_unQueued )
+        m_condFree.wait(lock);
+      return !m_bFailed;
+    }
+    /** @brief Durability barrier.
+     *  @details
+     *  Waits until all data has been written and commits it to the disk.
+     *  @return false if writing failed.
+     */
+    bool sync()
+    {
+      if( !wait() )
+        return false;
+      // the writer thread is idle now
+      FileStreamBase::commit();
+      return true;
+    }
+    /// @brief Returns true if writing failed in the writer thread or a
+    ///        write was rejected (BP_FAIL).
+    bool fail() const
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      return m_bFailed;
+    }
+    /// @brief Returns the number of buffers waiting for the writer thread.
+    size_t queued() const
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      return m_unQueued;
+    }
+    /// @brief Sets when the writer thread commits data to the disk (see
+    ///        FileStreamBase::setDurability()). Default is DM_NONE.
+    /// @attention Call it before open().
+    void setDurability( Durability eDurability, size_t unBytes=0, unsigned int unIntervalMs=0 ) { FileStreamBase::setDurability(eDurability,unBytes,unIntervalMs); }
+    Durability getDurability() const { return FileStreamBase::getDurability(); }
+    OpenMode mode() const { return FileStreamBase::mode(); }
+    bool canWrite() const { return true; }
+    int err_no() const { return FileStreamBase::err_no(); }
+    void error( std::ostream& os ) const { return FileStreamBase::error(os); }
+  private:
+    AsyncFileOStream( const AsyncFileOStream& );
+    AsyncFileOStream& operator=( const AsyncFileOStream& );
+    /// @brief Buffer that is filled by the producer and written by the
+    ///        writer thread.
+    struct Block
+    {
+      Block() : m_pch(NULL), m_unFill(0), m_nPos(0) {}
+      char*     m_pch;
+      size_t    m_unFill;
+      /// @brief File position of the first byte.
+      streampos m_nPos;
+    };
+    void init( size_t unBufferSize, size_t unBuffers, Backpressure eBackpressure )
+    {
+      BOOST_ASSERT(0 < unBufferSize && 0 < unBuffers);
+      m_unBufferSize = unBufferSize;
+      m_eBackpressure = eBackpressure;
+      m_blocks.resize(unBuffers);
+      for( size_t i=0; i<m_blocks.size(); i++ )
+        m_blocks[i].m_pch = new char[m_unBufferSize];
+      m_unHead = m_unTail = m_unQueued = 0;
+      m_bCurrent = false;
+      m_bStop = false;
+      m_bFailed = false;
+      m_nPos = m_nWriterPos = 0;
+      // commits happen on sync()
+      FileStreamBase::setDurability(DM_NONE);
+    }
+    /// @brief Makes the buffer at the ring's tail the current buffer.
+    bool acquire()
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      while( m_unQueued == m_blocks.size() )
+      {
+        if( BP_FAIL == m_eBackpressure )
+        {
+          m_bFailed = true;
+          return false;
+        }
+        m_condFree.wait(lock);
+      }
+      m_blocks[m_unTail].m_unFill = 0;
+      m_blocks[m_unTail].m_nPos = m_nPos;
+      m_bCurrent = true;
+      return true;
+    }
+    /// @brief Queues the current buffer.
+    void submit()
+    {
+      {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_unTail = (m_unTail+1) % m_blocks.size();
+        m_unQueued++;
+        m_bCurrent = false;
+      }
+      m_condWork.notify_one();
+    }
+    /// @brief Writer thread
+    void run()
+    {
+      for(;;)
+      {
+        Block* pBlock;
+        {
+          boost::mutex::scoped_lock lock(m_mutex);
+          while( 0 == m_unQueued && !m_bStop )
+            m_condWork.wait(lock);
+          if( 0 == m_unQueued )
+            return;
+          pBlock = &m_blocks[m_unHead];
+        }
+        // the producer doesn't touch queued buffers
+        if( pBlock->m_nPos != m_nWriterPos && OM_APPEND != mode() )
+          FileStreamBase::seek(pBlock->m_nPos,ORG_BEG);
+        FileStreamBase::write(pBlock->m_pch,pBlock->m_unFill);
+        m_nWriterPos = pBlock->m_nPos + (streampos)pBlock->m_unFill;
+        {
+          boost::mutex::scoped_lock lock(m_mutex);
+          if( FileStreamBase::fail() )
+            m_bFailed = true;
+          m_unHead = (m_unHead+1) % m_blocks.size();
+          m_unQueued--;
+        }
+        m_condFree.notify_all();
+      }
+    }
+    /// @brief Ring of buffers.
+    std::vector<Block>  m_blocks;
+    /// @brief Size of each buffer.
+    size_t              m_unBufferSize;
+    Backpressure        m_eBackpressure;
+    /// @brief Index of the next buffer the writer thread writes.
+    size_t              m_unHead;
+    /// @brief Index of the buffer the producer fills.
+    size_t              m_unTail;
+    /// @brief Number of buffers waiting for the writer thread.
+    size_t              m_unQueued;
+    /// @brief True if the producer owns the buffer at m_unTail.
+    bool                m_bCurrent;
+    /// @brief Tells the writer thread to stop when the queue is empty.
+    bool                m_bStop;
+    bool                m_bFailed;
+    /// @brief Logical write position of the producer.
+    streampos           m_nPos;
+    /// @brief File position behind the last write of the writer thread.
+    streampos           m_nWriterPos;
+    boost::thread       m_thread;
+    mutable boost::mutex m_mutex;
+    /// @brief Signals queued buffers to the writer thread.
+    boost::condition_variable m_condWork;
+    /// @brief Signals written buffers to the producer.
+    boost::condition_variable m_condFree;
+  };
+  /** @brief AsyncFileOStream is never the target of a kernel side copy
+   *         (see streamcopy()).
+   *  @details
+   *  Its write position is kept in user space and the writer thread owns
+   *  the file position, so streamcopy() copies through write().
+   *  @ingroup FileStreams
+   */
+  __inline huge_streampos nativecopy( AsyncFileOStream*, FileStreamBase*, huge_streampos ) { return 0; }
+}
+#endif
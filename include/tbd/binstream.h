@@ -7,11 +7,15 @@
 
 #include "domstream.h"
 #include <map>
+#include <unordered_map>
+#include <vector>
 #include <algorithm>
 #include "network.h"
 #include "dump.h"
 #include "memstream.h"
-#include <boost/numeric/conversion/converter.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <stack>
 
 #ifndef __TBD__BINSTREAM_H
 #define __TBD__BINSTREAM_H
@@ -65,7 +69,7 @@ namespace tbd
     : public Exception
   {
   public:
-    enum ErrCode { Ok, ChildrenSizeExceedsSizeType };
+    enum ErrCode { Ok, ChildrenSizeExceedsSizeType, AttributeAfterElements };
     /// @brief Constructor
     /// @param eErrCode Identifier for what has happened exception
     /// @param pNode node
@@ -99,6 +103,12 @@ namespace tbd
   {
   public:
     virtual DomNode* createNode() const { return new BinNode; }
+    virtual DomNode* createNode( const DomCommand& command ) const
+    {
+      if( NULL != arena() )
+        return new (arena()->allocate(sizeof(BinNode))) BinNode(command,arena());
+      return new BinNode(command);
+    }
     virtual void set( const bool& b ) { setValue((char)(b?1:0)); }
     virtual void set( const char& ch ) { setValue(ch); }
     virtual void set( const unsigned char& uch ) { setValue(uch); }
@@ -113,9 +123,9 @@ namespace tbd
     virtual void set( const double& d ) { setValue(d); }
     virtual void set( const std::string& str )
     { setBufferSize((S)str.size()); memcpy(m_pchBuffer,str.c_str(),m_unSize); }
-    virtual void set( const void* pvBuffer, S unSizeBytes )
-    { setBufferSize(unSizeBytes); memcpy(m_pchBuffer,pvBuffer,m_unSize); }
-    virtual void get( bool& rb ) { char ch; getValue(ch); rb = ch!=0; }
+    virtual void set( const void* pvBuffer, size_t unSizeBytes )
+    { setBufferSize(boost::numeric_cast<S>(unSizeBytes)); memcpy(m_pchBuffer,pvBuffer,m_unSize); }
+    virtual void get( bool& rb ) const { char ch; getValue(ch); rb = ch!=0; }
     virtual void get( char& rch ) const { getValue(rch); }
     virtual void get( unsigned char& ruch ) const { getValue(ruch); }
     virtual void get( short& rs ) const { getValue(rs); }
@@ -140,9 +150,13 @@ namespace tbd
     }
 
     /// @brief Standard constructor
-    BinNode() : m_unSize(0), m_pchBuffer(NULL) {}
+    BinNode() : DomNode(ROOT), m_unSize(0), m_pchBuffer(NULL), m_bOwner(true) {}
+    /// @brief Constructor of a node in an arena (see DomNode::createNode()).
+    explicit BinNode( DomArena* pArena ) : DomNode(ROOT,pArena), m_unSize(0), m_pchBuffer(NULL), m_bOwner(true) {}
+    /// @brief Constructor of a node created by a DOM command.
+    explicit BinNode( const DomCommand& command, DomArena* pArena=NULL ) : DomNode(command,pArena), m_unSize(0), m_pchBuffer(NULL), m_bOwner(true) {}
     /// @brief Destructor cleans the buffer if necessary.
-    virtual ~BinNode() { if( NULL != m_pchBuffer ) delete[] m_pchBuffer; }
+    virtual ~BinNode() { if( NULL != m_pchBuffer && m_bOwner && NULL == arena() ) delete[] m_pchBuffer; }
     /// @brief Return the buffer.
     /// @return A pointer to the buffer of this node.
     char* getBuffer() { return m_pchBuffer; }
@@ -158,9 +172,25 @@ namespace tbd
       BOOST_ASSERT(NULL==m_pchBuffer);
       // take the size
       m_unSize = unSize;
-      // create a new buffer of this size
-      m_pchBuffer = new char[m_unSize];
+      // create a new buffer of this size (in the arena if there is one)
+      m_pchBuffer = NULL != arena() ? (char*)arena()->allocate(m_unSize,1) : new char[m_unSize];
+      m_bOwner = true;
     }
+    /// @brief Let the buffer refer to external memory instead of copying it.
+    /// @attention The memory must stay valid and unchanged as long as this
+    ///            node exists. Don't call this method twice!
+    /// @param pchBuffer The memory to refer to.
+    /// @param unSize The size of the memory.
+    void setBufferRef( const char* pchBuffer, S unSize )
+    {
+      // check if there is a buffer already
+      BOOST_ASSERT(NULL==m_pchBuffer);
+      m_unSize = unSize;
+      m_pchBuffer = const_cast<char*>(pchBuffer);
+      m_bOwner = false;
+    }
+    /// @brief Returns true if the buffer refers to external memory.
+    bool isBufferRef() const { return !m_bOwner; }
     /// @brief Returns the overall size of this node.
     /// @return The size of this node, when it will be streamed including all
     ///         children and the size and ID information.
@@ -248,6 +278,8 @@ namespace tbd
     S           m_unSize;
     /// @brief Binary representation buffer.
     char*       m_pchBuffer;
+    /// @brief True if m_pchBuffer has to be deleted by this node.
+    bool        m_bOwner;
   };
 
   /// @brief Index map which is used to map node names with node IDs that are
@@ -276,6 +308,10 @@ namespace tbd
       BOOST_ASSERT(bSuccess);
       bSuccess = m_mapName2Id.insert(std::pair<std::string,I>(strName,id)).second;
       BOOST_ASSERT(bSuccess);
+      // relate the ID to the interned name too
+      const DomSymbol symbol = DomSymbols::global().intern(strName);
+      m_mapId2Symbol[id] = symbol;
+      m_mapSymbol2Id[symbol.id()] = id;
     }
     /// @brief Relates a name to an ID.
     /// @param strName The name to relate.
@@ -303,11 +339,41 @@ namespace tbd
       // return found name
       return &it->second;
     }
+    /// @brief Relates an interned name to an ID.
+    /// @details Names that aren't interned in DomSymbols::global() (nodes in
+    /// an arena) are related by name2id().
+    /// @param symbol The name to relate.
+    /// @return The related ID, if one exist
+    /// @attention This method crashes with assertion if name isn't related to any ID.
+    I symbol2id( DomSymbol symbol ) const
+    {
+      if( symbol.symbols() != &DomSymbols::global() )
+        return name2id(symbol.name());
+      typename std::unordered_map<unsigned int,I>::const_iterator it=m_mapSymbol2Id.find(symbol.id());
+      BOOST_ASSERT( it != m_mapSymbol2Id.end() );
+      return it->second;
+    }
+    /// @brief Relates an ID to an interned name.
+    /// @param id The ID to relate.
+    /// @param rSymbol Gets the related name.
+    /// @return false if the ID isn't related to a name.
+    bool id2symbol( I id, DomSymbol& rSymbol ) const
+    {
+      typename std::map<I,DomSymbol>::const_iterator it=m_mapId2Symbol.find(id);
+      if( it == m_mapId2Symbol.end() )
+        return false;
+      rSymbol = it->second;
+      return true;
+    }
   private:
     /// @brief Map of ID to name.
     std::map<I,std::string>  m_mapId2Name;
     /// @brief Map of name to ID.
     std::map<std::string,I>  m_mapName2Id;
+    /// @brief Map of ID to interned name.
+    std::map<I,DomSymbol>    m_mapId2Symbol;
+    /// @brief IDs by DomSymbol::id() of the global names.
+    std::unordered_map<unsigned int,I> m_mapSymbol2Id;
   };
 
   /// @brief Binary DOM output stream
@@ -342,72 +408,241 @@ namespace tbd
       : DomOStream(new BinNode<I,S>)
       , m_rBinIndex(rBinIndex)
     {}
+    using DomOStream::stream;
+    /** @brief Streams the DOM into an output stream while it is built (see
+     *         DomOStream::stream()).
+     *  @details
+     *  Closed nodes are written at once. A container that gets children
+     *  is written with a size placeholder that is patched with seekp() when
+     *  it closes, so the stream has to support tellp() and seekp().
+     *  @param os The stream to write to. It has to stay valid until the
+     *         streaming mode is switched off or this instance is destroyed.
+     */
+    template<class O> void stream( O& os )
+    {
+      DomOStream::stream(NULL);
+      m_pWriter.reset(new Writer<O>(*this,os));
+      DomOStream::stream(m_pWriter.get());
+    }
     /// @brief Writes the DOM into an std::ostream.
+    /// @details
+    /// Headers and small payloads are collected and larger payloads are
+    /// referenced in a GatherBatch. So the output reaches streams that support
+    /// OStream::writev() (like FileOStream) in a few gathered writes.
     /// @param os The ostream to write to.
     /// @return The size of the generated output in bytes.
     template<class O> S write(O& os)  const throw(BinNodeException*)
     {
-      // remember the current write position of ostream
-      typename O::streampos pbegin = os.tellp();
-      // write all nodes
-      for( const_iterator it=getRoot()->begin(); it!=getRoot()->end(); it++ )
-        write(os,(BinNode<I,S>*)*it);
-      // calculate the size of our output
-      return boost::numeric::converter<S,typename O::streampos>(os.tellp() - pbegin);
+      std::vector<S> sizes;
+      this->sizes(sizes);
+      return write(os,sizes);
     }
+    /// @brief Writes the DOM into a new buffer of exactly the output's size.
+    /// @param rpBuffer Gets the buffer (free it with delete[]) or NULL if
+    ///        the DOM is empty.
+    /// @param runSize Gets the size of the output.
     void write( char*& rpBuffer, size_t& runSize )  const throw(BinNodeException*)
     {
-      // string stream to stream output into
-      MemOStream<size_t> mos;
+      std::vector<S> sizes;
+      runSize = this->sizes(sizes);
+      rpBuffer = NULL;
+      if( 0 == runSize )
+        return;
+      // allocate once
+      rpBuffer = new char[runSize];
+      FixedMemOStream<size_t> os(rpBuffer,runSize);
+      write(os,sizes);
+      BOOST_ASSERT(!os.fail() && os.size() == runSize);
+    }
+    /** @brief Writes the DOM into a buffer given by the caller.
+     *  @details
+     *  Nothing is written if the buffer is too small. Use size() to get the
+     *  needed size in advance.
+     *  @param pBuffer Buffer to write into (e.g. a slot in shared memory).
+     *  @param unCapacity Size of the buffer.
+     *  @param runSize Gets the size of the output.
+     *  @return false if the buffer is too small.
+     */
+    bool write( char* pBuffer, size_t unCapacity, size_t& runSize ) const throw(BinNodeException*)
+    {
+      std::vector<S> sizes;
+      runSize = this->sizes(sizes);
+      if( runSize > unCapacity )
+        return false;
+      FixedMemOStream<size_t> os(pBuffer,unCapacity);
+      write(os,sizes);
+      return true;
+    }
+    /// @brief Returns the exact size of the output write() would generate.
+    size_t size() const throw(BinNodeException*)
+    {
+      std::vector<S> sizes;
+      return this->sizes(sizes);
+    }
+  protected:
+    /// @brief Writer of the streaming mode.
+    template<class O> class Writer
+      : public DomWriter
+    {
+    public:
+      Writer( const BinOStream& bos, O& os ) : m_bos(bos), m_batch(os), m_pos(os.tellp()) {}
+      ~Writer() { m_batch.flush(); }
+      virtual void begin( DomNode* pNode, int )
       {
-        // write the DOM to the stream
-        write(mos);
+        // a node has either a payload or children
+        BOOST_ASSERT( NULL == ((BinNode<I,S>*)pNode)->getBuffer() );
+        // the size of the children is patched in end()
+        m_stckPos.push(m_pos);
+        writeHeader(m_batch,BinNode<I,S>::makeContainer(m_bos.m_rBinIndex.symbol2id(pNode->getSymbol())),0);
+        m_pos += sizeof(I)+sizeof(S);
+        // the children so far are the attributes
+        for( iterator it=pNode->begin(); it!=pNode->end(); it++ )
+          write((BinNode<I,S>*)*it);
+        m_stckAttributes.push(pNode->size());
+      }
+      virtual void end( DomNode* pNode, int nDeepness, bool bBegun )
+      {
+        if( bBegun )
+        {
+          const typename O::streampos pos = m_stckPos.top();
+          m_stckPos.pop();
+          const size_t unAttributes = m_stckAttributes.top();
+          m_stckAttributes.pop();
+          // the written attributes are the only children left
+          if( pNode->size() != unAttributes )
+            throw BinNodeException(BinNodeException::AttributeAfterElements,pNode);
+          const typename O::streampos unSize = m_pos - pos - (typename O::streampos)(sizeof(I)+sizeof(S));
+          // check if size type S can take unSize
+          if( (size_t)unSize > bit::bitmask<S>() )
+            throw BinNodeException(BinNodeException::ChildrenSizeExceedsSizeType,pNode);
+          patch(pos+(typename O::streampos)sizeof(I),(S)unSize);
+        }
+        else
+          write((BinNode<I,S>*)pNode);
+        if( 0 == nDeepness )
+          flush();
       }
-      mos.detach(rpBuffer,runSize);
+      virtual void flush() { m_batch.flush(); }
+    private:
+      /// @brief Writes a node with all children.
+      void write( BinNode<I,S>* pNode )
+      {
+        std::vector<S> sizes;
+        m_pos += (typename O::streampos)BinOStream::sizes(pNode,sizes);
+        const S* pSize = sizes.empty() ? NULL : &sizes[0];
+        // copy the payloads, the node is deleted after end()
+        m_bos.write(m_batch,pNode,pSize,true);
+      }
+      /// @brief Overwrites a size that has been written already.
+      void patch( typename O::streampos pos, S unSize )
+      {
+        m_batch.flush();
+        O& os = m_batch.stream();
+        unSize = host2net(unSize);
+        os.seekp(pos);
+        os.write((const char*)&unSize,sizeof(unSize));
+        os.seekp(m_pos);
+      }
+      const BinOStream&                 m_bos;
+      GatherBatch<O>                    m_batch;
+      /// @brief Position behind the written data.
+      typename O::streampos             m_pos;
+      /// @brief Positions of the begun containers.
+      std::stack<typename O::streampos> m_stckPos;
+      /// @brief Number of attributes written with the begun containers.
+      std::stack<size_t>                m_stckAttributes;
+    };
+    /// @brief Writes the DOM with the container sizes calculated by sizes().
+    template<class O> S write(O& os, const std::vector<S>& sizes)  const throw(BinNodeException*)
+    {
+      // remember the current write position of ostream
+      typename O::streampos pbegin = os.tellp();
+      {
+        // collect the output
+        GatherBatch<O> batch(os);
+        // container sizes in pre-order
+        const S* pSize = sizes.empty() ? NULL : &sizes[0];
+        // write all nodes
+        for( const_iterator it=getRoot()->begin(); it!=getRoot()->end(); it++ )
+          write(batch,(BinNode<I,S>*)*it,pSize);
+        // write what's left
+        batch.flush();
+      }
+      // calculate the size of our output
+      return boost::numeric_cast<S>(os.tellp() - pbegin);
     }
-  protected:
-    template<class O> void write( O& os, BinNode<I,S>* pNode ) const throw(BinNodeException*)
+    template<class O> void write( GatherBatch<O>& batch, BinNode<I,S>* pNode, const S*& rpSize, bool bCopy=false ) const throw(BinNodeException*)
     {
       // has data?
       if( NULL != pNode->getBuffer() )
       {
         // fetch the id for the node's name
-        I id = m_rBinIndex.name2id(pNode->getName());
-        // convert ID to network byte order
-        id = host2net(id);
-        // write ID
-        os.write((const char*)&id,sizeof(id));
-        // get size of our payload
-        S unSize = ((BinNode<I,S>*)pNode)->getBufferSize();
-        // convert size to network byte order
-        unSize = host2net(unSize);
-        // write the size
-        os.write((const char*)&unSize,sizeof(unSize));
-        // write the buffer
-        os.write(((BinNode<I,S>*)pNode)->getBuffer(),((BinNode<I,S>*)pNode)->getBufferSize());
+        I id = m_rBinIndex.symbol2id(pNode->getSymbol());
+        // write ID and size with one copy
+        writeHeader(batch,id,pNode->getBufferSize());
+        // refer to the buffer
+        if( bCopy )
+          batch.write(pNode->getBuffer(),pNode->getBufferSize());
+        else
+          batch.writeref(pNode->getBuffer(),pNode->getBufferSize());
       }
       else
       {
         // get the ID of the node's name and mark it as container
-        I id = BinNode<I,S>::makeContainer(m_rBinIndex.name2id(pNode->getName()));
-        // convert ID to network byte order
-        id = host2net(id);
-        // write ID
-        os.write((const char*)&id,sizeof(id));
-        // Calculate sizes of all children
-        S unSize = ((BinNode<I,S>*)pNode)->getChildrenSize();
-        // convert size to network byte order
-        unSize = host2net(unSize);
-        // write size
-        os.write((const char*)&unSize,sizeof(unSize));
+        I id = BinNode<I,S>::makeContainer(m_rBinIndex.symbol2id(pNode->getSymbol()));
+        // write ID and the cached size of all children
+        writeHeader(batch,id,*rpSize++);
         // write all children
         for( iterator it=pNode->begin(); it!=pNode->end(); it++ )
-          write(os,(BinNode<I,S>*)*it);
+          write(batch,(BinNode<I,S>*)*it,rpSize,bCopy);
       }
     }
+    /** @brief Calculates the sizes of all container nodes in one pass.
+     *  @param rSizes Gets the children sizes of all containers in the order
+     *         they are written.
+     *  @return The size of the whole output.
+     */
+    size_t sizes( std::vector<S>& rSizes ) const throw(BinNodeException*)
+    {
+      size_t unSize=0;
+      for( const_iterator it=getRoot()->begin(); it!=getRoot()->end(); it++ )
+        unSize += sizes((BinNode<I,S>*)*it,rSizes);
+      return unSize;
+    }
+    /// @brief Calculates the sizes of pNode and all containers below.
+    /// @return The overall size of pNode.
+    static size_t sizes( BinNode<I,S>* pNode, std::vector<S>& rSizes ) throw(BinNodeException*)
+    {
+      if( NULL != pNode->getBuffer() )
+        return pNode->getBufferSize()+sizeof(I)+sizeof(S);
+      // reserve the container's entry before its children's
+      size_t unIndex = rSizes.size();
+      rSizes.push_back(0);
+      size_t unSize=0;
+      for( iterator it=pNode->begin(); it!=pNode->end(); it++ )
+        unSize += sizes((BinNode<I,S>*)*it,rSizes);
+      // check if size type S can take unSize
+      if( unSize > bit::bitmask<S>() )
+        throw BinNodeException(BinNodeException::ChildrenSizeExceedsSizeType,pNode);
+      rSizes[unIndex] = (S)unSize;
+      return unSize+sizeof(I)+sizeof(S);
+    }
+    /// @brief Writes ID and size of a node in network byte order.
+    template<class O> static void writeHeader( GatherBatch<O>& batch, I id, S unSize )
+    {
+      char achHeader[sizeof(I)+sizeof(S)];
+      // convert ID and size to network byte order
+      id = host2net(id);
+      unSize = host2net(unSize);
+      memcpy(achHeader,&id,sizeof(id));
+      memcpy(achHeader+sizeof(id),&unSize,sizeof(unSize));
+      batch.write(achHeader,sizeof(achHeader));
+    }
   private:
     /// @brief Index that maps name identifiers to IDs and backwards.
     const BinIndex<I,S>&    m_rBinIndex;
+    /// @brief Writer of stream(O&).
+    boost::scoped_ptr<DomWriter> m_pWriter;
   };
 
   /// @brief Exception thrown by the BinIStream class
@@ -464,8 +699,23 @@ namespace tbd
     ///            is destroyed. This shouldn't become a problem because the
     ///            BinIndex is such a "const" thing!
     BinIStream( const BinIndex<I,S>& rBinIndex, S maxSize=~S(0))
-      : DomIStream(new BinNode<I,S>), m_MaxSize(maxSize), m_rBinIndex(rBinIndex)
+      : DomIStream(new BinNode<I,S>), m_MaxSize(maxSize), m_rBinIndex(rBinIndex), m_bZeroCopy(false)
     {}
+    /// @brief Returns true if payloads refer to the input instead of being
+    ///        copied.
+    bool zerocopy() const { return m_bZeroCopy; }
+    /** @brief Enable or disable referring to payloads in the input.
+     *  @details
+     *  If enabled and the input stream can lend its content (see
+     *  IStream::borrow()) the nodes refer to the payloads in the input instead
+     *  of copying them. Input streams that can't lend their content are copied
+     *  as usual.
+     *  @attention The input (e.g. the buffer given to read() or a MemIStream
+     *             or MmapIStream) has to outlive this stream.
+     *  @param bZeroCopy true to enable
+     *  @return the previous setting
+     */
+    bool zerocopy( bool bZeroCopy ) { bool b=m_bZeroCopy; m_bZeroCopy=bZeroCopy; return b; }
     /// @brief Parses a binary stream out of an std::istream.
     /// @param is Input stream to read from.
     /// @throw BinParseException May be thrown when parsing fails.
@@ -488,12 +738,22 @@ namespace tbd
     static unsigned int getHeaderLength() { return sizeof(I)+sizeof(S); }
     template<class IS> void readHeader( IS& is, I& rId, S& rSize ) throw(BinParseException<IS>*)
     {
-      // read ID
-      is.read((char*)&rId,sizeof(rId));
+      // take ID and size at once if possible
+      const char* pchHeader = tbd::borrow(is,sizeof(rId)+sizeof(rSize));
+      if( NULL != pchHeader )
+      {
+        memcpy(&rId,pchHeader,sizeof(rId));
+        memcpy(&rSize,pchHeader+sizeof(rId),sizeof(rSize));
+      }
+      else
+      {
+        // read ID
+        is.read((char*)&rId,sizeof(rId));
+        // read size
+        is.read((char*)&rSize,sizeof(rSize));
+      }
       // convert ID to host byte order
       rId = net2host(rId);
-      // read size
-      is.read((char*)&rSize,sizeof(rSize));
       // convert size to host byte order
       rSize = net2host(rSize);
       // check size for not being too huge
@@ -521,13 +781,13 @@ namespace tbd
       {
         // get the name that is related to the read ID and clear it's container
         // mark
-        const std::string* pName=m_rBinIndex.id2name(BinNode<I,S>::unmakeContainer(id));
+        DomSymbol symbol;
         // if name wasn't found
-        if( NULL == pName )
+        if( !m_rBinIndex.id2symbol(BinNode<I,S>::unmakeContainer(id),symbol) )
           // throw exception
           throw BinParseException<IS>(BinParseException<IS>::UnknownNodeId,is.tellg());
         // fill the nodes name with this name
-        pNode->setName(*pName);
+        pNode->setSymbol(symbol);
         // remember stream position for validating the read size
         typename IS::streampos pos = is.tellg();
         // read until read size is reached
@@ -543,13 +803,23 @@ namespace tbd
       else
       {
         // get the name that is related to the read ID.
-        const std::string* pName=m_rBinIndex.id2name(id);
+        DomSymbol symbol;
         // if name wasn't found
-        if( NULL == pName )
+        if( !m_rBinIndex.id2symbol(id,symbol) )
           // throw exception
           throw BinParseException<IS>(BinParseException<IS>::UnknownNodeId,is.tellg());
         // fill the nodes name with this name
-        pNode->setName(*pName);
+        pNode->setSymbol(symbol);
+        // refer to the payload if possible
+        if( m_bZeroCopy )
+        {
+          const char* pchPayload = tbd::borrow(is,size);
+          if( NULL != pchPayload )
+          {
+            pNode->setBufferRef(pchPayload,size);
+            return;
+          }
+        }
         // initialize the binary buffer of the node
         ((BinNode<I,S>*)pNode)->setBufferSize(size);
         // read the buffer's content
@@ -563,8 +833,11 @@ namespace tbd
     /// @throw BinParseException May be thrown when parsing fails.
     template<class IS> void readchild( IS& is, BinNode<I,S>* pNode ) throw(BinParseException<IS>*)
     {
-      // create a child
-      BinNode<I,S>* pChild = new BinNode<I,S>;
+      // create a child (in the arena if there is one)
+      DomArena* pArena = pNode->arena();
+      BinNode<I,S>* pChild = NULL != pArena
+        ? new (pArena->allocate(sizeof(BinNode<I,S>))) BinNode<I,S>(pArena)
+        : new BinNode<I,S>;
       // attach it to the parent node
       pNode->push_back(pChild);
       // read the node from the binary stream
@@ -578,6 +851,8 @@ namespace tbd
     S                     m_MaxSize;
     /// @brief Index that maps name identifiers to IDs and backwards.
     const BinIndex<I,S>&  m_rBinIndex;
+    /// @brief Refer to payloads instead of copying them.
+    bool                  m_bZeroCopy;
   };
 
   typedef BinOStream<unsigned long,unsigned long> Bin32OStream;
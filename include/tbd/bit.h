@@ -5,6 +5,9 @@
 /// @date 05.11.2006
 ///////////////////////////////////////////////////////////////////////////////
 #include <boost/assert.hpp>
+#include <stddef.h>
+#include <limits>
+#include <type_traits>
 
 #ifndef __TBD__BIT_H
 #define __TBD__BIT_H
@@ -114,6 +117,9 @@ namespace tbd
 
     /// @brief copy lower bits of a value into another value by inserting
     /// them at the lower side.
+    /// @details
+    /// Works for all integral types up to 64 bits. If uCount equals the bit
+    /// size of S the previous content of s is replaced completely.
     /// @param s Destination buffer of type S.
     /// @param t Source buffer of type T.
     /// @param uCount Number of bits to copy.
@@ -122,26 +128,26 @@ namespace tbd
     template<class S, class T>
     __inline void copyBits( S& s, const T& t, const Count& uCount, const Count& uStart=0 )
     {
+      typedef unsigned long long U;
       // uCount has to be smaller than destination buffer
       BOOST_ASSERT(uCount<=sizeof(S)*8);
-      // this method runs only if uCount doesn't exceeds bit size of unsigned
-      // int
-      BOOST_ASSERT(uCount<=sizeof(unsigned int)*8);
+      // this method runs only if uCount doesn't exceeds bit size of U
+      BOOST_ASSERT(uCount<=sizeof(U)*8);
       // t has to be large enough
       BOOST_ASSERT(uStart+uCount<=sizeof(T)*8);
-      // if uCount matches the number of bits in unsigned int
-      if( uCount == sizeof(unsigned int)*8 )
-        // reserve uCount bits in s and OR it with the significant part of the
-        // value
-        s = (S)((s << uCount) | (S)((t >> uStart)));
+      // nothing to copy (and shifts by uStart might be out of range)
+      if( 0 == uCount )
+        return;
+      // significant part of the value (bits above sizeof(T) are masked out,
+      // so sign extension doesn't matter)
+      const U tMask = uCount < sizeof(U)*8 ? ~(~(U)0 << uCount) : ~(U)0;
+      const U u = ((U)t >> uStart) & tMask;
+      // reserve uCount bits in s and OR it with the significant part of the
+      // value
+      if( uCount < sizeof(S)*8 )
+        s = (S)(((U)s << uCount) | u);
       else
-      {
-        // create a mask for the shifted source value
-        const unsigned int tMask = ~(~(unsigned int)0 << uCount);
-        // reserve uCount bits in s and OR it with the significant part of the
-        // value
-        s = (S)((s << uCount) | ((S)((t >> uStart) & tMask)));
-      }
+        s = (S)u;
     }
     /// @brief converts a bit count value of type T into the corresponding
     /// byte count of type T and asserts when the bit count isn't byte
@@ -156,17 +162,47 @@ namespace tbd
     {
       return t*(T)8;
     }
+    namespace intern
+    {
+      /// @brief Table of used bits of all byte values.
+      template<int N=0> struct UsedBits
+      {
+        static const unsigned char s_auchTable[256];
+      };
+      template<int N> const unsigned char UsedBits<N>::s_auchTable[256] =
+      {
+        0,1,2,2,3,3,3,3,4,4,4,4,4,4,4,4,
+        5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
+        6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
+        6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
+        7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+        7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+        7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+        7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+        8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,
+        8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,
+        8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,
+        8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,
+        8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,
+        8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,
+        8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,
+        8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8
+      };
+    }
     /// @brief Returns the number of "used" bits in a value
+    /// @details Zero and negative values have no used bits.
     /// @ingroup Bit
     template<class T> __inline unsigned char usedBits( T ulValue )
     {
+      if( !(ulValue>0) )
+        return 0;
+      unsigned long long ull = (unsigned long long)ulValue;
       unsigned char i=0;
-      while( ulValue>0 )
-      {
-        ulValue >>= 1;
-        i++;
-      }
-      return i;
+      // narrow down to the highest used byte
+      if( ull >> 32 ) { ull >>= 32; i += 32; }
+      if( ull >> 16 ) { ull >>= 16; i += 16; }
+      if( ull >> 8 )  { ull >>= 8;  i += 8; }
+      return (unsigned char)(i + intern::UsedBits<>::s_auchTable[ull]);
     }
     /// @ingroup Bit
     /// @brief Returns the bitmask for a given type or instance.
@@ -217,6 +253,157 @@ namespace tbd
     {
       v = (v & ~((bitmask<V>() >> (sizeof(V)*8-NUM)) << FROM)) | (((V)t & (bitmask<V>() >> (sizeof(V)*8-NUM))) << FROM);
     }
+    namespace intern
+    {
+      /// @brief Packs groups of 8 items with BITS bits each (BITS is known at
+      ///        compile time so the compiler can unroll the loops).
+      template<unsigned int BITS, class T>
+      __inline void pack( unsigned char* puch, const T* pt, size_t unGroups )
+      {
+        const unsigned long long ullMask = ~(~0ULL << BITS);
+        for( size_t g=0; g<unGroups; g++, pt+=8 )
+        {
+          unsigned long long acc=0;
+          unsigned int used=0;
+          for( unsigned int i=0; i<8; i++ )
+          {
+            acc = (acc << BITS) | ((unsigned long long)pt[i] & ullMask);
+            used += BITS;
+            for( ; used>=8; used-=8 )
+              *puch++ = (unsigned char)(acc >> (used-8));
+          }
+        }
+      }
+      /// @brief Generic variant of pack() for any bit count up to 32.
+      template<class T>
+      __inline void pack( unsigned char* puch, const T* pt, size_t unGroups, unsigned int uBits )
+      {
+        const unsigned long long ullMask = ~(~0ULL << uBits);
+        for( size_t g=0; g<unGroups; g++, pt+=8 )
+        {
+          unsigned long long acc=0;
+          unsigned int used=0;
+          for( unsigned int i=0; i<8; i++ )
+          {
+            acc = (acc << uBits) | ((unsigned long long)pt[i] & ullMask);
+            used += uBits;
+            for( ; used>=8; used-=8 )
+              *puch++ = (unsigned char)(acc >> (used-8));
+          }
+        }
+      }
+      /// @brief Tells if T is signed, enums by their underlying type.
+      template<class T, bool ENUM=std::is_enum<T>::value> struct IsSigned
+      {
+        enum { value = std::numeric_limits<T>::is_signed };
+      };
+      template<class T> struct IsSigned<T,true>
+      {
+        enum { value = std::is_signed<typename std::underlying_type<T>::type>::value };
+      };
+      /// @brief Sign extends or masks a value of uBits bits.
+      template<class T> __inline T extend( unsigned long long ull, unsigned int uBits )
+      {
+        if( IsSigned<T>::value && uBits < 64 )
+        {
+          const unsigned long long ullSign = 1ULL << (uBits-1);
+          ull = (ull ^ ullSign) - ullSign;
+        }
+        return (T)ull;
+      }
+      /// @brief Unpacks groups of 8 items with BITS bits each.
+      template<unsigned int BITS, class T>
+      __inline void unpack( T* pt, const unsigned char* puch, size_t unGroups )
+      {
+        const unsigned long long ullMask = ~(~0ULL << BITS);
+        for( size_t g=0; g<unGroups; g++, pt+=8 )
+        {
+          unsigned long long acc=0;
+          unsigned int avail=0;
+          for( unsigned int i=0; i<8; i++ )
+          {
+            for( ; avail<BITS; avail+=8 )
+              acc = (acc << 8) | *puch++;
+            avail -= BITS;
+            pt[i] = extend<T>((acc >> avail) & ullMask,BITS);
+          }
+        }
+      }
+      /// @brief Generic variant of unpack() for any bit count up to 32.
+      template<class T>
+      __inline void unpack( T* pt, const unsigned char* puch, size_t unGroups, unsigned int uBits )
+      {
+        const unsigned long long ullMask = ~(~0ULL << uBits);
+        for( size_t g=0; g<unGroups; g++, pt+=8 )
+        {
+          unsigned long long acc=0;
+          unsigned int avail=0;
+          for( unsigned int i=0; i<8; i++ )
+          {
+            for( ; avail<uBits; avail+=8 )
+              acc = (acc << 8) | *puch++;
+            avail -= uBits;
+            pt[i] = extend<T>((acc >> avail) & ullMask,uBits);
+          }
+        }
+      }
+    }
+#define TBD_BIT_PACK_CASES(X) \
+      X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) \
+      X(13) X(14) X(15) X(16) X(20) X(24) X(32)
+    /** @brief Packs the lower uBits bits of n items into bytes.
+     *  @details
+     *  The items are stored one after another beginning with the highest
+     *  bit of the first byte (like BitOStream::put() does). Only complete
+     *  groups of 8 items are packed, so the result always ends on a byte
+     *  boundary. Common bit counts use unrolled kernels.
+     *  @param pchDst Memory that gets (n/8)*uBits bytes.
+     *  @param pt Items to pack.
+     *  @param n Number of items.
+     *  @param uBits Number of bits per item (1..32).
+     *  @return Number of packed items (n rounded down to a multiple of 8).
+     *  @ingroup Bit
+     */
+    template<class T>
+    __inline size_t pack( char* pchDst, const T* pt, size_t n, unsigned int uBits )
+    {
+      BOOST_ASSERT(0<uBits && uBits<=32);
+      unsigned char* puch = (unsigned char*)pchDst;
+      const size_t unGroups = n/8;
+      switch( uBits )
+      {
+#define TBD_BIT_PACK(BITS) case BITS: intern::pack<BITS>(puch,pt,unGroups); break;
+        TBD_BIT_PACK_CASES(TBD_BIT_PACK)
+#undef TBD_BIT_PACK
+        default: intern::pack(puch,pt,unGroups,uBits); break;
+      }
+      return unGroups*8;
+    }
+    /** @brief Unpacks n items of uBits bits each from bytes (see pack()).
+     *  @details Signed types get sign extended.
+     *  @param pt Items that get the result.
+     *  @param pchSrc Memory with (n/8)*uBits bytes.
+     *  @param n Number of items.
+     *  @param uBits Number of bits per item (1..32).
+     *  @return Number of unpacked items (n rounded down to a multiple of 8).
+     *  @ingroup Bit
+     */
+    template<class T>
+    __inline size_t unpack( T* pt, const char* pchSrc, size_t n, unsigned int uBits )
+    {
+      BOOST_ASSERT(0<uBits && uBits<=32);
+      const unsigned char* puch = (const unsigned char*)pchSrc;
+      const size_t unGroups = n/8;
+      switch( uBits )
+      {
+#define TBD_BIT_UNPACK(BITS) case BITS: intern::unpack<BITS>(pt,puch,unGroups); break;
+        TBD_BIT_PACK_CASES(TBD_BIT_UNPACK)
+#undef TBD_BIT_UNPACK
+        default: intern::unpack(pt,puch,unGroups,uBits); break;
+      }
+      return unGroups*8;
+    }
+#undef TBD_BIT_PACK_CASES
   }
 }
 
@@ -0,0 +1,228 @@
+///////////////////////////////////////////////////////////////////////////////
+/// @file bitcodec.h
+/// @brief Variable length integer codes for bit streams
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TBD__BITCODEC_H
+#define __TBD__BITCODEC_H
+
+#include "bit.h"
+#include "bitstream.h"
+
+/// @defgroup BitCodecs Bit Codecs
+/// @brief Variable length integer codes that can be used as manipulators of
+///        bit streams.
+/// @ingroup BitStreams
+/// @details
+/// Small values get short codes, so counters and IDs don't need the full
+/// size of their type.
+/// @code
+///   tbd::BitOStream< tbd::MemStream<> > bos(ms);
+///   bos << tbd::varint(ulCount) << tbd::zigzag(lDelta) << tbd::expgolomb(unId) << tbd::rice(unLen,3);
+///   ...
+///   tbd::BitIStream< tbd::MemStream<> > bis(ms);
+///   bis >> tbd::varint(ulCount) >> tbd::zigzag(lDelta) >> tbd::expgolomb(unId) >> tbd::rice(unLen,3);
+/// @endcode
+/// @li varint() is LEB128: 7 bits per byte, lowest group first, the highest
+///     bit of a byte signals that another one follows.
+/// @li zigzag() maps signed values to unsigned ones (0,-1,1,-2,...) and
+///     writes them as varint.
+/// @li expgolomb() writes an Exp-Golomb code of order k: w=value+2^k is
+///     written with as many leading cleared bits as w has bits behind its
+///     highest set bit minus k.
+/// @li rice() writes a Golomb-Rice code with parameter k: value>>k as unary
+///     code (cleared bits terminated by a set bit) followed by the lower k
+///     bits.
+namespace tbd
+{
+  namespace bitcodec
+  {
+    /// @brief Manipulator that carries an item and a code parameter.
+    /// @ingroup BitCodecs
+    template<class T, int CODE> struct Code
+    {
+      Code( T* pt, unsigned int uParam ) : m_pt(pt), m_uParam(uParam) {}
+      T*            m_pt;
+      unsigned int  m_uParam;
+    };
+    enum { VARINT, ZIGZAG, EXPGOLOMB, RICE };
+
+    /// @brief Puts uBits cleared bits.
+    template<class BS> __inline void putZeros( BS& bs, size_t uBits )
+    {
+      for( ; uBits >= 64; uBits -= 64 )
+        bs.put(0ULL,64);
+      if( uBits > 0 )
+        bs.put(0ULL,uBits);
+    }
+    /// @brief Puts a LEB128 code.
+    template<class BS> __inline void putVarint( BS& bs, unsigned long long ull )
+    {
+      unsigned char auch[10];
+      size_t unBytes=0;
+      for( ; ull >= 0x80; ull >>= 7 )
+        auch[unBytes++] = (unsigned char)(ull | 0x80);
+      auch[unBytes++] = (unsigned char)ull;
+      bs.putn((const char*)auch,unBytes);
+    }
+    /// @brief Gets a LEB128 code byte by byte.
+    template<class BS> __inline unsigned long long getVarint( BS& bs )
+    {
+      unsigned long long ull=0;
+      for( unsigned int uShift=0; uShift<64; uShift+=7 )
+      {
+        unsigned char uch;
+        bs.get(uch);
+        // the 10th byte carries only the highest bit of 64
+        if( 63 == uShift && 0 != (uch & 0x7E) )
+          TBD_THROW(BitParseException(BitParseException::InvalidCode));
+        ull |= (unsigned long long)(uch & 0x7F) << uShift;
+        if( 0 == (uch & 0x80) )
+          return ull;
+      }
+      TBD_THROW(BitParseException(BitParseException::InvalidCode));
+    }
+    /** @brief Gets a LEB128 code from memory.
+     *  @details
+     *  Codes of up to 7 bytes are decoded from one lookahead() without a
+     *  loop: a mask scan finds the first byte with a cleared highest bit
+     *  and the 7 bit groups are compacted in the register. Longer codes and
+     *  codes at the end of the memory are read byte by byte.
+     *  @n BitIStream isn't decoded this way, its lookahead() reads from the
+     *  source stream and costs more than it saves.
+     */
+    template<class C> __inline unsigned long long getVarint( BitMemIStream<C>& bs )
+    {
+      enum { LOOKAHEAD_BYTES = 7 };
+      unsigned long long w;
+      const size_t unBytes = bs.lookahead(w,LOOKAHEAD_BYTES*8)/8;
+      // bytes in stream order with the first one lowest, the missing bytes
+      // are cleared and must not count as terminators
+      unsigned long long v = details::bswap((boost::uint64_t)(w << 8));
+      const unsigned long long ullStops = ~v & 0x8080808080808080ULL & ~(~0ULL << unBytes*8);
+      if( 0 == ullStops )
+        return getVarint<BitMemIStream<C> >(bs);
+      // highest bit of the first terminating byte
+      const unsigned long long ullLast = ullStops & (0-ullStops);
+      v &= ((ullLast << 1) - 1) & 0x7F7F7F7F7F7F7FULL;
+      v = (v & 0x007F007F007F007FULL) | ((v & 0x7F007F007F007F00ULL) >> 1);
+      v = (v & 0x00003FFF00003FFFULL) | ((v & 0x3FFF00003FFF0000ULL) >> 2);
+      v = (v & 0x000000000FFFFFFFULL) | ((v & 0x0FFFFFFF00000000ULL) >> 4);
+      // one bit per byte of the code summed up by a multiplication
+      bs.skip(8*((((ullLast-1) & 0x0101010101010101ULL) * 0x0101010101010101ULL) >> 56));
+      return v;
+    }
+    /// @brief Maps a signed value to an unsigned one (0,-1,1,-2,... ->
+    ///        0,1,2,3,...).
+    __inline unsigned long long zigzag( long long ll )
+    { return ((unsigned long long)ll << 1) ^ (unsigned long long)(ll >> 63); }
+    /// @brief Reverses zigzag().
+    __inline long long unzigzag( unsigned long long ull )
+    { return (long long)(ull >> 1) ^ -(long long)(ull & 1); }
+    /// @brief Puts an Exp-Golomb code of order uK.
+    template<class BS> __inline void putExpGolomb( BS& bs, unsigned long long ull, unsigned int uK )
+    {
+      BOOST_ASSERT( uK < 64 && ull <= ~0ULL - (1ULL << uK) );
+      const unsigned long long w = ull + (1ULL << uK);
+      const size_t unBits = bit::usedBits(w);
+      const size_t unZeros = unBits-1-uK;
+      // the leading zeros are part of w if they fit into one put
+      if( unZeros+unBits <= 64 )
+        bs.put(w,unZeros+unBits);
+      else
+      {
+        putZeros(bs,unZeros);
+        bs.put(w,unBits);
+      }
+    }
+    /// @brief Gets an Exp-Golomb code of order uK.
+    template<class BS> __inline unsigned long long getExpGolomb( BS& bs, unsigned int uK )
+    {
+      const size_t unBits = bs.getUnary()+uK;
+      if( unBits >= 64 )
+        TBD_THROW(BitParseException(BitParseException::InvalidCode));
+      unsigned long long w = 1ULL << unBits;
+      if( unBits > 0 )
+      {
+        unsigned long long ull;
+        bs.get(ull,unBits);
+        w |= ull;
+      }
+      return w - (1ULL << uK);
+    }
+    /// @brief Puts a Golomb-Rice code with parameter uK.
+    template<class BS> __inline void putRice( BS& bs, unsigned long long ull, unsigned int uK )
+    {
+      BOOST_ASSERT( uK < 64 );
+      const unsigned long long q = ull >> uK;
+      // unary terminator and remainder
+      const unsigned long long r = (1ULL << uK) | (ull & ~(~0ULL << uK));
+      if( q+1+uK <= 64 )
+        bs.put(r,(size_t)q+1+uK);
+      else
+      {
+        putZeros(bs,(size_t)q);
+        bs.put(r,1+uK);
+      }
+    }
+    /// @brief Gets a Golomb-Rice code with parameter uK.
+    template<class BS> __inline unsigned long long getRice( BS& bs, unsigned int uK )
+    {
+      const unsigned long long q = bs.getUnary();
+      if( uK > 0 && (q >> (64-uK)) != 0 )
+        TBD_THROW(BitParseException(BitParseException::InvalidCode));
+      unsigned long long r=0;
+      if( uK > 0 )
+        bs.get(r,uK);
+      return (q << uK) | r;
+    }
+    template<class BS, class T> __inline void put( BS& bs, const Code<T,VARINT>& c )     { putVarint(bs,(unsigned long long)*c.m_pt); }
+    template<class BS, class T> __inline void put( BS& bs, const Code<T,ZIGZAG>& c )     { putVarint(bs,zigzag((long long)*c.m_pt)); }
+    template<class BS, class T> __inline void put( BS& bs, const Code<T,EXPGOLOMB>& c )  { putExpGolomb(bs,(unsigned long long)*c.m_pt,c.m_uParam); }
+    template<class BS, class T> __inline void put( BS& bs, const Code<T,RICE>& c )       { putRice(bs,(unsigned long long)*c.m_pt,c.m_uParam); }
+    template<class BS, class T> __inline void get( BS& bs, const Code<T,VARINT>& c )     { *c.m_pt = (T)getVarint(bs); }
+    template<class BS, class T> __inline void get( BS& bs, const Code<T,ZIGZAG>& c )     { *c.m_pt = (T)unzigzag(getVarint(bs)); }
+    template<class BS, class T> __inline void get( BS& bs, const Code<T,EXPGOLOMB>& c )  { *c.m_pt = (T)getExpGolomb(bs,c.m_uParam); }
+    template<class BS, class T> __inline void get( BS& bs, const Code<T,RICE>& c )       { *c.m_pt = (T)getRice(bs,c.m_uParam); }
+  }
+
+  /// @brief LEB128 code of an unsigned item.
+  /// @ingroup BitCodecs
+  template<class T> __inline bitcodec::Code<const T,bitcodec::VARINT> varint( const T& t )
+  { return bitcodec::Code<const T,bitcodec::VARINT>(&t,0); }
+  template<class T> __inline bitcodec::Code<T,bitcodec::VARINT> varint( T& t )
+  { return bitcodec::Code<T,bitcodec::VARINT>(&t,0); }
+  /// @brief Zigzag LEB128 code of a signed item.
+  /// @ingroup BitCodecs
+  template<class T> __inline bitcodec::Code<const T,bitcodec::ZIGZAG> zigzag( const T& t )
+  { return bitcodec::Code<const T,bitcodec::ZIGZAG>(&t,0); }
+  template<class T> __inline bitcodec::Code<T,bitcodec::ZIGZAG> zigzag( T& t )
+  { return bitcodec::Code<T,bitcodec::ZIGZAG>(&t,0); }
+  /// @brief Exp-Golomb code of order k of an unsigned item.
+  /// @ingroup BitCodecs
+  template<class T> __inline bitcodec::Code<const T,bitcodec::EXPGOLOMB> expgolomb( const T& t, unsigned int k=0 )
+  { return bitcodec::Code<const T,bitcodec::EXPGOLOMB>(&t,k); }
+  template<class T> __inline bitcodec::Code<T,bitcodec::EXPGOLOMB> expgolomb( T& t, unsigned int k=0 )
+  { return bitcodec::Code<T,bitcodec::EXPGOLOMB>(&t,k); }
+  /// @brief Golomb-Rice code with parameter k of an unsigned item.
+  /// @ingroup BitCodecs
+  template<class T> __inline bitcodec::Code<const T,bitcodec::RICE> rice( const T& t, unsigned int k )
+  { return bitcodec::Code<const T,bitcodec::RICE>(&t,k); }
+  template<class T> __inline bitcodec::Code<T,bitcodec::RICE> rice( T& t, unsigned int k )
+  { return bitcodec::Code<T,bitcodec::RICE>(&t,k); }
+
+  /// @ingroup BitCodecs
+  template<class O, class C, class T, int CODE>
+  __inline BitOStream<O,C>& operator<<( BitOStream<O,C>& bos, const bitcodec::Code<T,CODE>& c )
+  { bitcodec::put(bos,c); return bos; }
+  /// @ingroup BitCodecs
+  template<class I, class C, class T, int CODE>
+  __inline BitIStream<I,C>& operator>>( BitIStream<I,C>& bis, const bitcodec::Code<T,CODE>& c )
+  { bitcodec::get(bis,c); return bis; }
+  /// @ingroup BitCodecs
+  template<class C, class T, int CODE>
+  __inline BitMemIStream<C>& operator>>( BitMemIStream<C>& bis, const bitcodec::Code<T,CODE>& c )
+  { bitcodec::get(bis,c); return bis; }
+}
+
+#endif
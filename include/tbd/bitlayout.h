@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+/// @file bitlayout.h
+/// @brief Compile time bit layouts of records
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TBD__BITLAYOUT_H
+#define __TBD__BITLAYOUT_H
+
+#include "bit.h"
+#include "bitstream.h"
+
+/// @defgroup BitLayouts Bit Layouts
+/// @brief Bit layouts of records that are declared at compile time.
+/// @ingroup BitStreams
+/// @details
+/// A layout lists the members of a record with their bit widths in stream
+/// order. Adjacent fields are merged into words of up to 64 bits at compile
+/// time, so a record is put or get with one shift and mask per field and
+/// one stream call per word.
+/// @code
+///   struct Header { unsigned char version; Type type; bool last; unsigned short length; };
+///   typedef tbd::bit::Layout<
+///     TBD_BITFIELD(Header,version,3),
+///     TBD_BITFIELD(Header,type,5),
+///     TBD_BITFIELD(Header,last,1),
+///     TBD_BITFIELD(Header,length,15) > HeaderLayout;
+///   HeaderLayout::put(bos,header);      // instead of bos << bits(header.version,3) << ...
+///   HeaderLayout::get(bis,header);
+///   char ach[HeaderLayout::BYTES];
+///   HeaderLayout::pack(ach,header);     // raw buffers
+///   HeaderLayout::unpack(ach,header);
+/// @endcode
+/// Signed members get sign extended, enums if their underlying type is
+/// signed:
+/// @code
+///   enum class Delta : signed char { Down=-1, Same=0, Up=1 };
+///   struct Move { Delta delta; };
+///   typedef tbd::bit::Layout< TBD_BITFIELD(Move,delta,2) > MoveLayout;   // Down unpacks as -1
+/// @endcode
+
+/// @brief Declares a field of a bit layout (see tbd::bit::Layout).
+/// @param R Record type.
+/// @param m Member of R.
+/// @param bits Number of bits (1..64).
+/// @ingroup BitLayouts
+#define TBD_BITFIELD(R,m,bits) tbd::bit::Field<R,decltype(R::m),&R::m,bits>
+
+namespace tbd
+{
+  namespace bit
+  {
+    /// @brief Field of a bit layout: member M of record R with BITS bits.
+    /// @ingroup BitLayouts
+    template<class R, class T, T R::*M, unsigned int BITS>
+    struct Field
+    {
+      static_assert(0 < BITS && BITS <= 64, "a field takes 1 to 64 bits");
+      typedef R record_type;
+      enum { bits = BITS };
+      /// @brief Returns the lower BITS bits of the member.
+      static __inline unsigned long long value( const R& r )
+      {
+        const unsigned long long ull = (unsigned long long)(r.*M);
+        return BITS < 64 ? ull & ~(~0ULL << (BITS%64)) : ull;
+      }
+      /// @brief Sets the member from BITS bits.
+      static __inline void assign( R& r, unsigned long long ull )
+      {
+        r.*M = intern::extend<T>(ull,BITS);
+      }
+    };
+    namespace intern
+    {
+      /// @brief Bits of the word that starts with the first field (fields
+      ///        are added while the word doesn't exceed 64 bits).
+      template<unsigned int USED, class... FIELDS> struct WordBits
+      {
+        enum { value = USED };
+      };
+      template<unsigned int USED, class F, class... FIELDS> struct WordBits<USED,F,FIELDS...>
+      {
+        enum { value = USED+F::bits <= 64 ? (unsigned int)WordBits<USED+F::bits,FIELDS...>::value : USED };
+      };
+      /// @brief Sum of the bits of all fields.
+      template<class... FIELDS> struct SumBits
+      {
+        enum { value = 0 };
+      };
+      template<class F, class... FIELDS> struct SumBits<F,FIELDS...>
+      {
+        enum { value = F::bits + SumBits<FIELDS...>::value };
+      };
+      /// @brief Puts the fields word by word.
+      template<unsigned int WORD, unsigned int REST, class... FIELDS> struct PutWord;
+      template<class... FIELDS> struct PutFields
+      {
+        template<class BS, class R> static __inline void run( BS&, const R& ) {}
+      };
+      template<class F, class... FIELDS> struct PutFields<F,FIELDS...>
+      {
+        template<class BS, class R> static __inline void run( BS& bs, const R& r )
+        {
+          const unsigned int WORD = WordBits<0,F,FIELDS...>::value;
+          PutWord<WORD,WORD,F,FIELDS...>::run(bs,r,0ULL);
+        }
+      };
+      /// @brief Collects the fields of a word of WORD bits with REST bits
+      ///        left.
+      template<unsigned int WORD, unsigned int REST, class... FIELDS> struct PutWord
+      {
+        template<class BS, class R> static __inline void run( BS& bs, const R&, unsigned long long ull )
+        {
+          bs.put(ull,WORD);
+        }
+      };
+      template<unsigned int WORD, unsigned int REST, class F, class... FIELDS> struct PutWord<WORD,REST,F,FIELDS...>
+      {
+        template<class BS, class R> static __inline void run( BS& bs, const R& r, unsigned long long ull )
+        {
+          next(bs,r,ull,Bool<F::bits <= REST>());
+        }
+      private:
+        template<bool B> struct Bool {};
+        template<class BS, class R> static __inline void next( BS& bs, const R& r, unsigned long long ull, Bool<true> )
+        {
+          // shifting by 64 bits isn't defined
+          ull = F::bits < 64 ? (ull << (F::bits%64)) | F::value(r) : F::value(r);
+          PutWord<WORD,REST-F::bits,FIELDS...>::run(bs,r,ull);
+        }
+        template<class BS, class R> static __inline void next( BS& bs, const R& r, unsigned long long ull, Bool<false> )
+        {
+          // the word is complete
+          bs.put(ull,WORD);
+          PutFields<F,FIELDS...>::run(bs,r);
+        }
+      };
+      /// @brief Gets the fields word by word.
+      template<unsigned int REST, class... FIELDS> struct GetWord;
+      template<class... FIELDS> struct GetFields
+      {
+        template<class BS, class R> static __inline void run( BS&, R& ) {}
+      };
+      template<class F, class... FIELDS> struct GetFields<F,FIELDS...>
+      {
+        template<class BS, class R> static __inline void run( BS& bs, R& r )
+        {
+          const unsigned int WORD = WordBits<0,F,FIELDS...>::value;
+          unsigned long long ull;
+          bs.get(ull,WORD);
+          GetWord<WORD,F,FIELDS...>::run(bs,r,ull);
+        }
+      };
+      /// @brief Extracts the fields of a word with REST bits left.
+      template<unsigned int REST, class... FIELDS> struct GetWord
+      {
+        template<class BS, class R> static __inline void run( BS&, R&, unsigned long long ) {}
+      };
+      template<unsigned int REST, class F, class... FIELDS> struct GetWord<REST,F,FIELDS...>
+      {
+        template<class BS, class R> static __inline void run( BS& bs, R& r, unsigned long long ull )
+        {
+          next(bs,r,ull,Bool<F::bits <= REST>());
+        }
+      private:
+        template<bool B> struct Bool {};
+        template<class BS, class R> static __inline void next( BS& bs, R& r, unsigned long long ull, Bool<true> )
+        {
+          F::assign(r,(ull >> (REST-F::bits)) & (F::bits < 64 ? ~(~0ULL << (F::bits%64)) : ~0ULL));
+          GetWord<REST-F::bits,FIELDS...>::run(bs,r,ull);
+        }
+        template<class BS, class R> static __inline void next( BS& bs, R& r, unsigned long long, Bool<false> )
+        {
+          GetFields<F,FIELDS...>::run(bs,r);
+        }
+      };
+      /// @brief Writes bits MSB first into a raw buffer.
+      class BufferBits
+      {
+      public:
+        BufferBits( char* pch ) : m_puch((unsigned char*)pch), m_ull(0), m_uBits(0) {}
+        __inline void put( unsigned long long ull, unsigned int uBits )
+        {
+          if( m_uBits+uBits > 64 )
+          {
+            // two parts, so the cache doesn't overflow
+            put(ull >> 32,uBits-32);
+            ull &= 0xFFFFFFFFULL;
+            uBits = 32;
+          }
+          m_ull = uBits < 64 ? (m_ull << (uBits%64)) | ull : ull;
+          m_uBits += uBits;
+          for( ; m_uBits >= 8; m_uBits -= 8 )
+            *m_puch++ = (unsigned char)(m_ull >> (m_uBits-8));
+        }
+        /// @brief Writes the remaining bits padded with cleared bits.
+        __inline void flush()
+        {
+          if( m_uBits > 0 )
+            *m_puch++ = (unsigned char)(m_ull << (8-m_uBits));
+          m_uBits = 0;
+        }
+      private:
+        unsigned char*      m_puch;
+        unsigned long long  m_ull;
+        unsigned int        m_uBits;
+      };
+    }
+    /** @brief Bit layout of a record.
+     *  @details
+     *  FIELDS are Field types (see TBD_BITFIELD) of the same record in
+     *  stream order. The layout is the same as putting each field with
+     *  BitOStream::put(value,bits) (MSB first).
+     *  @ingroup BitLayouts
+     */
+    template<class F, class... FIELDS>
+    struct Layout
+    {
+      typedef typename F::record_type record_type;
+      enum
+      {
+        /// @brief Number of bits of the layout.
+        BITS = intern::SumBits<F,FIELDS...>::value,
+        /// @brief Number of bytes pack() writes.
+        BYTES = (BITS+7)/8
+      };
+      /// @brief Puts the fields of a record into a bit stream.
+      template<class BS> static __inline void put( BS& bos, const record_type& r )
+      {
+        intern::PutFields<F,FIELDS...>::run(bos,r);
+      }
+      /// @brief Gets the fields of a record from a bit stream.
+      template<class BS> static __inline void get( BS& bis, record_type& r )
+      {
+        intern::GetFields<F,FIELDS...>::run(bis,r);
+      }
+      /// @brief Writes the fields of a record into BYTES bytes, the bits
+      ///        behind BITS are cleared.
+      static __inline void pack( char* pch, const record_type& r )
+      {
+        intern::BufferBits bb(pch);
+        intern::PutFields<F,FIELDS...>::run(bb,r);
+        bb.flush();
+      }
+      /// @brief Reads the fields of a record from BYTES bytes.
+      static __inline void unpack( const char* pch, record_type& r )
+      {
+        BitMemIStream<> bmis(pch,BYTES);
+        intern::GetFields<F,FIELDS...>::run(bmis,r);
+      }
+    };
+  }
+}
+
+#endif
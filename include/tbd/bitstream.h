@@ -11,11 +11,13 @@
 
 #define _SCL_SECURE_NO_DEPRECATE
 #include <stdexcept>
+#include <algorithm>
 #include <sstream>
 #include "network.h"
 #include "dump.h"
 #include "exception.h"
 #include "bit.h"
+#include "stream.h"
 #include "string.h"
 
 #ifdef _MSC_VER
@@ -88,6 +90,13 @@
 /// @see BitStreamExamples
 namespace tbd
 {
+  namespace details
+  {
+    /// @brief Clears eofbit and failbit a short read leaves in a std::istream.
+    template<class C, class Tr> __inline void clearEof( std::basic_istream<C,Tr>* pis ) { if( !pis->bad() ) pis->clear(); }
+    /// @brief Other streams recover with the next successful operation.
+    __inline void clearEof( const void* ) {}
+  }
   /// @brief Base class of BitOStream and BitIStream that manages the bit cache.
   /// @ingroup BitStreams
   class BitStream
@@ -99,7 +108,7 @@ namespace tbd
     __BITSTEAM_INLINE bool aligned( unsigned char uchBits=8 ) const { return m_uCount.aligned(uchBits); }
   protected:
     /// @brief Type to use as bit cache.
-    typedef unsigned int        T;
+    typedef unsigned long long  T;
     /// @brief Constructor
     BitStream() : m_tCurrent(0), m_uCount(0) { }
     /// @brief Return the bit cache.
@@ -136,6 +145,11 @@ namespace tbd
   {
   };
   /// @brief Bit output stream
+  /// @details
+  /// Full bit caches and small items are collected in an internal buffer
+  /// that is written into the destination stream in blocks of BUFFER_SIZE
+  /// bytes. The buffer is written by flush(), seekp(), seekp2end(), ostream()
+  /// and the destructor.
   /// @ingroup BitStreams
   template<class O, class C=NulConfig>
   class BitOStream
@@ -143,9 +157,14 @@ namespace tbd
     , public C
   {
   public:
+    enum
+    {
+      /// @brief Size of the internal buffer.
+      BUFFER_SIZE = 4096
+    };
     /// @brief Configures this output bit stream to write all the results
     /// into a specific output stream of type O.
-    BitOStream( O& os ) : m_os(os) { }
+    BitOStream( O& os ) : m_os(os), m_unBuffered(0) { }
     ~BitOStream() { flush2stream(); }
     O& ostream() { flush2stream(); seekp(tellp()); return m_os; }
     /// @brief Before this method flushes this stream it may append bits to
@@ -186,25 +205,29 @@ namespace tbd
       if( aligned() )
       {
         // flush the bit cache
-        flush2stream();
+        cache2buffer();
         // if S is doesn't need byte order conversion
         if( sizeof(S) == 1 )
         {
-          // write the items directly (fastest) into the destination stream
-          m_os.write((const char*)psItems,unNumItems);
+          // write the items directly (fastest) into the buffer
+          stage((const char*)psItems,unNumItems);
         }
         else
         {
-          // buffer that stores an item in network byte order
-          S _s;
-          // write every item in network byte order into destination stream
-          // (fast)
-          for( size_t i=0; i<unNumItems; i++ )
+          // convert the items chunk by chunk into the buffer (fast)
+          for( size_t i=0; i<unNumItems; )
           {
-            // convert current item into network byte order
-            _s = tbd::host2net(psItems[i]);
-            // write it into the destination stream
-            m_os.write((const char*)&_s,sizeof(S));
+            size_t unChunk = std::min(unNumItems-i,(BUFFER_SIZE-m_unBuffered)/sizeof(S));
+            if( 0 == unChunk )
+            {
+              // buffer is full
+              m_os.write(m_achBuffer,m_unBuffered);
+              m_unBuffered = 0;
+              continue;
+            }
+            tbd::host2net(m_achBuffer+m_unBuffered,psItems+i,unChunk);
+            m_unBuffered += unChunk*sizeof(S);
+            i += unChunk;
           }
         }
       }
@@ -213,9 +236,42 @@ namespace tbd
         // write every item through the bit cache into destination stream
         // (slowest)
         for( size_t i=0; i<unNumItems; i++ )
+        {
+          // use the item's bit pattern (S might be a floating point type)
+          typename details::Uint<sizeof(S)>::type u;
+          memcpy(&u,psItems+i,sizeof(S));
           // put the item into the stream using the bit cache
-          put(psItems[i],sizeof(S)*8);
+          put(u,sizeof(S)*8);
+        }
+      }
+    }
+    /** @brief Put the lower uBits bits of some items into this bit stream.
+     *  @details
+     *  Groups of 8 items are packed by bit::pack() into bytes that are
+     *  written at once. This works at any bit position, but is fastest with
+     *  bit streams that are currently byte aligned.
+     *  @param psItems Pointer to the first item.
+     *  @param unNumItems Number of items to put.
+     *  @param uBits Number of bits per item.
+     */
+    template<class S>
+    void putBits( const S* psItems, size_t unNumItems, const bit::Count& uBits )
+    {
+      BOOST_ASSERT( uBits>0 && uBits<=sizeof(S)*8 );
+      size_t i=0;
+      // the pack kernels take up to 32 bits
+      if( uBits <= 32 )
+      {
+        char ach[PACK_ITEMS*4];
+        while( unNumItems-i >= 8 )
+        {
+          size_t unPacked = bit::pack(ach,psItems+i,std::min<size_t>(unNumItems-i,PACK_ITEMS),(unsigned int)uBits);
+          putBytes(ach,unPacked/8*uBits);
+          i += unPacked;
+        }
       }
+      for( ; i<unNumItems; i++ )
+        put(psItems[i],uBits);
     }
     template<class S, class NR>
     __BITSTEAM_INLINE void putr( const S sItem, NR unNumRepeat )
@@ -230,10 +286,10 @@ namespace tbd
       if( aligned() )
       {
         // flush the bit cache
-        flush2stream();
-        // write item repeatedly into destination stream (fast)
+        cache2buffer();
+        // write item repeatedly into the buffer (fast)
         for( NR i=0; i<unNumRepeat; i++ )
-          m_os.write((const char*)&_s,sizeof(S));
+          stage((const char*)&_s,sizeof(S));
       }
       else
       {
@@ -255,11 +311,11 @@ namespace tbd
       if( aligned() )
       {
         // flush the bit cache
-        flush2stream();
+        cache2buffer();
         // copy s into network byte order
         S _s = tbd::host2net(s);
         // write the item in correct byte order
-        m_os.write((const char*)&_s,sizeof(S));
+        stage((const char*)&_s,sizeof(S));
       }
       else
       {
@@ -304,8 +360,8 @@ namespace tbd
           bit::copyBits(current(),s,_left,uCopy);
           // convert the bit cache into network byte order
           host2net();
-          // write bit cache into destination stream
-          m_os.write((const char*)&current(),sizeof(T));
+          // write bit cache into the buffer
+          stage((const char*)&current(),sizeof(T));
           // reset bit cache
           set(0,0);
         }
@@ -356,8 +412,8 @@ namespace tbd
     streampos tellp() const
     {
         // convert the current put position of the destination stream into bits
-        // and add what's in the bit cache and return the result
-        return (streampos)m_os.tellp()*8+count();
+        // and add what's in the buffer and the bit cache and return the result
+        return ((streampos)m_os.tellp()+(streampos)m_unBuffered)*8+count();
     }
     /// @brief Set the current write bit position of this stream.
     /// @todo cannot set position bitwise
@@ -366,16 +422,28 @@ namespace tbd
     void align( const bit::Count& uCount=8, bool bFillBit=0 )
     {
       bit::Count disalignment=tellp() % uCount;
-      while( disalignment > 0 )
+      // fill up to the next multiple of uCount
+      bit::Count fill=disalignment > 0 ? uCount-disalignment : 0;
+      while( fill > 0 )
       {
-        int n=(int)(32<(unsigned int)disalignment)?32:(unsigned int)disalignment;
-        put(bFillBit?bit::bitmask<unsigned int>():0,n);
-        disalignment -= n;
+        bit::Count n=std::min<size_t>(fill,sizeof(T)*8);
+        put(bFillBit?bit::bitmask<T>():0,n);
+        fill -= n;
       }
     }
   protected:
-    /// @brief Flush the bit cache into the destination stream
+    /// @brief Flush the bit cache and the buffer into the destination stream
     void flush2stream()
+    {
+      cache2buffer();
+      if( 0 < m_unBuffered )
+      {
+        m_os.write(m_achBuffer,m_unBuffered);
+        m_unBuffered = 0;
+      }
+    }
+    /// @brief Flush the bit cache into the buffer
+    void cache2buffer()
     {
       // check alignment
       BOOST_ASSERT(aligned());
@@ -384,12 +452,59 @@ namespace tbd
       {
         // convert the bit cache into network byte order
         host2net();
-        // write the uses bytes of the bit cache into the destination stream
-        m_os.write((const char*)&current()+left()/8,count()/8);
+        // write the uses bytes of the bit cache into the buffer
+        stage((const char*)&current()+left()/8,count()/8);
         // reset the bit cache
         set(0,0);
       }
     }
+    enum
+    {
+      /// @brief Number of items putBits() packs at once.
+      PACK_ITEMS = 512
+    };
+    /// @brief Put bytes at the current (maybe unaligned) bit position.
+    void putBytes( const char* pch, size_t unSize )
+    {
+      if( aligned() )
+      {
+        cache2buffer();
+        stage(pch,unSize);
+        return;
+      }
+      // through the bit cache 64 bits at once
+      size_t i=0;
+      for( ; i+sizeof(T)<=unSize; i+=sizeof(T) )
+      {
+        T t;
+        memcpy(&t,pch+i,sizeof(T));
+        put(tbd::net2host(t),sizeof(T)*8);
+      }
+      for( ; i<unSize; i++ )
+        put((unsigned char)pch[i],8);
+    }
+    /// @brief Append bytes to the buffer and write the buffer into the
+    /// destination stream when it is full.
+    __BITSTEAM_INLINE void stage( const char* pch, size_t unSize )
+    {
+      if( unSize <= BUFFER_SIZE - m_unBuffered )
+      {
+        if( 0 < unSize )
+          memcpy(m_achBuffer+m_unBuffered,pch,unSize);
+        m_unBuffered += unSize;
+        return;
+      }
+      m_os.write(m_achBuffer,m_unBuffered);
+      m_unBuffered = 0;
+      // large blocks go directly into the destination stream
+      if( unSize >= BUFFER_SIZE )
+        m_os.write(pch,unSize);
+      else
+      {
+        memcpy(m_achBuffer,pch,unSize);
+        m_unBuffered = unSize;
+      }
+    }
     template<class S>
     void putstr( const char* psz, S size, S len )
     {
@@ -420,6 +535,10 @@ namespace tbd
   private:
     /// @brief Reference to the destination stream.
     O&            m_os;
+    /// @brief Bytes that haven't been written into the destination stream.
+    char          m_achBuffer[BUFFER_SIZE];
+    /// @brief Number of used bytes in m_achBuffer.
+    size_t        m_unBuffered;
   };
 
   /// @brief Generates a pair of a const reference to an item of type T and a bit count.
@@ -441,7 +560,7 @@ namespace tbd
     : public Exception
   {
   public:
-    enum ErrCode { Ok, UnexpectedEndOfFile };
+    enum ErrCode { Ok, UnexpectedEndOfFile, InvalidCode };
     /// @brief Constructor
     /// @param eErrCode Identifier for what has happened exception
     explicit BitParseException(ErrCode eErrCode) : m_eErrCode(eErrCode) {}
@@ -450,6 +569,12 @@ namespace tbd
     ErrCode   m_eErrCode;
   };
   /// @brief Bit input stream
+  /// @details
+  /// The bit cache reads up to 8 bytes ahead, so while this bit stream is in
+  /// use the read position of the source stream may be ahead of tellg().
+  /// istream(), borrow() and the destructor give the unconsumed bytes back by
+  /// seeking the source stream. Use them instead of the source stream
+  /// directly if you continue reading there.
   /// @ingroup BitStreams
   template<class I, class C=NulConfig>
   class BitIStream
@@ -463,7 +588,7 @@ namespace tbd
     ~BitIStream()
     {
       BOOST_ASSERT(aligned());
-      m_is.seekg(m_is.tellg()-(count()/8));
+      m_is.seekg(m_is.tellg()-(std::streamoff)(count()/8));
     }
     I& istream() { seekg(tellg()); return m_is; }
     /// @brief Get some items of type S from this bit stream and convert
@@ -480,20 +605,112 @@ namespace tbd
         read(((char*)psItems),unNumItems*sizeof(S));
         // byte order conversion needed?
         if( sizeof(S) > 1 )
-        {
-          // convert all items into host byte order
-          for( size_t i=0; i<unNumItems; i++ )
-            // convert the current item into host byte order
-            psItems[i] = tbd::net2host(psItems[i]);
-        }
+          // convert all items into host byte order at once
+          tbd::net2host(psItems,psItems,unNumItems);
       }
       else
       {
         // get all items using the bit cache
         for( size_t i=0; i<unNumItems; i++ )
-          // get one item in host byte order using the bit cache
-          get(psItems[i],sizeof(S)*8);
+        {
+          // get the item's bit pattern (S might be a floating point type)
+          typename details::Uint<sizeof(S)>::type u;
+          get(u,sizeof(S)*8);
+          memcpy(psItems+i,&u,sizeof(S));
+        }
+      }
+    }
+    /** @brief Get some items of uBits bits each (see BitOStream::putBits()).
+     *  @details
+     *  The bytes of groups of 8 items are read at once and unpacked by
+     *  bit::unpack(). Signed types get sign extended.
+     *  @param psItems Pointer to the first item to fill.
+     *  @param unNumItems Number of items to get.
+     *  @param uBits Number of bits per item.
+     */
+    template<class S>
+    void getBits( S* psItems, size_t unNumItems, const bit::Count& uBits )
+    {
+      BOOST_ASSERT( uBits>0 && uBits<=sizeof(S)*8 );
+      size_t i=0;
+      // the unpack kernels take up to 32 bits
+      if( uBits <= 32 )
+      {
+        char ach[PACK_ITEMS*4];
+        while( unNumItems-i >= 8 )
+        {
+          size_t unItems = std::min<size_t>(unNumItems-i,PACK_ITEMS)/8*8;
+          getBytes(ach,unItems/8*uBits);
+          bit::unpack(psItems+i,ach,unItems,(unsigned int)uBits);
+          i += unItems;
+        }
+      }
+      for( ; i<unNumItems; i++ )
+        get(psItems[i],uBits);
+    }
+    /** @brief Get a unary code: count the cleared bits up to the next set
+     *  bit.
+     *  @details
+     *  Works on the whole bit cache at once instead of bit by bit.
+     *  @return Number of cleared bits (the set bit is consumed too).
+     */
+    size_t getUnary()
+    {
+      size_t unZeros=0;
+      for(;;)
+      {
+        if( empty() )
+        {
+          // let get() refill the bit cache
+          unsigned char uch;
+          get(uch,1);
+          if( 0 != uch )
+            return unZeros;
+          unZeros++;
+          continue;
+        }
+        // the valid bits are the lower count() bits
+        const T t = count() < sizeof(T)*8 ? current() & ~(~(T)0 << count()) : current();
+        if( 0 == t )
+        {
+          unZeros += count();
+          set(0,0);
+          continue;
+        }
+        const size_t unUsed = bit::usedBits(t);
+        unZeros += count()-unUsed;
+        subCount(count()-unUsed+1);
+        return unZeros;
+      }
+    }
+    /** @brief Get up to uCount bits without moving the read position.
+     *  @details
+     *  Unlike peek() this doesn't fail at the end of the stream: missing
+     *  bits are cleared. Table driven decoders (e.g. HuffmanCode) use it to
+     *  look at the next code.
+     *  @param s Reference to the item that gets the bits.
+     *  @param uCount Number of bits to look at (up to LOOKAHEAD).
+     *  @return Number of bits that really are available (up to uCount).
+     */
+    template<class S> __BITSTEAM_INLINE size_t lookahead( S& s, const bit::Count& uCount )
+    {
+      BOOST_ASSERT( uCount>0 && uCount<=LOOKAHEAD && uCount<=sizeof(S)*8 );
+      if( uCount > count() )
+      {
+        // append whole bytes from the source stream to the valid bits
+        unsigned char auch[sizeof(T)];
+        const size_t unRead = readCache((char*)auch,left()/8);
+        for( size_t i=0; i<unRead; i++ )
+          current() = (current() << 8) | auch[i];
+        addCount((unsigned int)(unRead*8));
       }
+      if( uCount <= count() )
+      {
+        s = (S)((current() >> (count()-uCount)) & ~(~(T)0 << uCount));
+        return uCount;
+      }
+      s = (S)((current() << (uCount-count())) & ~(~(T)0 << uCount));
+      return count();
     }
     __BITSTEAM_INLINE void get( bool& s )
     {
@@ -533,12 +750,10 @@ namespace tbd
       if( empty() )
       {
         // read a portion from the source stream
-        m_is.read((char*)&current(),sizeof(T));
-        // adjust bit cache size
-        setCount(8*m_is.gcount());
-        current() <<= sizeof(T)*8-count();
+        setCount(8*readCache((char*)&current(),sizeof(T)));
         if( count()<uCount && count()!=sizeof(T)*8 )
           TBD_THROW(BitParseException(BitParseException::UnexpectedEndOfFile));
+        current() <<= sizeof(T)*8-count();
         // convert bit cache into host byte order
         net2host();
       }
@@ -564,16 +779,14 @@ namespace tbd
           // adjust copied bits counter
           uCopied += count();
           // read a portion from the source stream
-          m_is.read((char*)&current(),sizeof(T));
-          // adjust bit cache size
-          setCount(8*m_is.gcount());
+          setCount(8*readCache((char*)&current(),sizeof(T)));
           // check if we need something but got nothing
           if( !(uCopied == uCount || count() > 0) )
             TBD_THROW(BitParseException(BitParseException::UnexpectedEndOfFile));
           // convert bit cache into host byte order
           net2host();
           // if bit cache wasn't filled completely
-          if( count() < sizeof(T)*8 )
+          if( 0 < count() && count() < sizeof(T)*8 )
             // move the bits in the cache to the correct position
             current() >>= (sizeof(T)*8 - count());
         }
@@ -586,10 +799,10 @@ namespace tbd
         // if type S is signed and s is negative
         if( bit::is_type_signed< S >() && 0 != (s & (((S)1) << (uCount-1))) )
           // set all bits above the read ones
-          s |= (~S(0)) << uCount;
+          s = (S)(s | (S)(~(T)0 << uCount));
         else
           // clear all bits above the read ones
-          s &= ~((~S(0)) << uCount);
+          s = (S)(s & (S)~(~(T)0 << uCount));
       }
     }
     __BITSTEAM_INLINE BitIStream& operator>>( bool& rb )                  { int n=0; get(n,1); rb=(n!=0); return *this; }
@@ -626,6 +839,13 @@ namespace tbd
       if( pairStr.second == bit::bitmask<S>() )
         // get size from stream
         get(pairStr.second);
+      // take the string content at once if possible
+      const char* psz = (aligned() && pairStr.second > 0) ? borrow(pairStr.second) : NULL;
+      if( NULL != psz )
+      {
+        pairStr.first->assign(psz,pairStr.second);
+        return *this;
+      }
       // resize string to parameter size
       pairStr.first->resize(pairStr.second);
       // get string content from stream
@@ -693,7 +913,7 @@ namespace tbd
       // if skip bits beyond the bit cache
       if( ullCount > (streampos)count() )
       {
-        m_is.seekg(m_is.tellg()+(ullCount-count())/(streampos)8);
+        m_is.seekg(m_is.tellg()+(std::streamoff)((ullCount-count())/(streampos)8));
         ullCount = (ullCount-count()) % (streampos)8;
         set(0,0);
       }
@@ -701,6 +921,27 @@ namespace tbd
         get(n,(unsigned int)ullCount);
     }
     virtual bool fail() const { return m_is.fail(); }
+    /** @brief Borrow some bytes from the source stream without copying.
+     *  @details
+     *  Returns a pointer to the next unNumBytes bytes if the source stream
+     *  can lend them (see IStream::borrow()) and moves the read position
+     *  behind them. Otherwise NULL is returned and the read position stays.
+     *  @param unNumBytes Number of bytes to borrow.
+     *  @attention This method crashes with assertion if this bit stream
+     *  isn't byte aligned!
+     */
+    const char* borrow( size_t unNumBytes )
+    {
+      // this bit stream must be byte aligned for this method to work
+      BOOST_ASSERT( aligned() );
+      // give the bytes in the bit cache back to the source stream
+      if( !empty() )
+      {
+        m_is.seekg(m_is.tellg()-(std::streamoff)(count()/8));
+        set(0,0);
+      }
+      return tbd::borrow(m_is,unNumBytes);
+    }
     void align( const bit::Count& uCount=8 )
     {
       streampos disalignment=tellg() % uCount;
@@ -733,30 +974,429 @@ namespace tbd
 
         // if we need more bytes
         if( unNumBytes > unRead )
-        {
           // read the remaining bytes directly from source stream
-          m_is.read(((char*)psItems)+unRead,unNumBytes-unRead);
-          if( unNumBytes-unRead != (size_t)m_is.gcount() )
+          readSource(((char*)psItems)+unRead,unNumBytes-unRead);
+      }
+      else
+        // read the bytes directly from source stream
+        readSource(((char*)psItems),unNumBytes);
+    }
+    enum
+    {
+      /// @brief Number of items getBits() unpacks at once.
+      PACK_ITEMS = 512,
+      /// @brief Maximum number of bits lookahead() takes.
+      LOOKAHEAD = 56
+    };
+    /// @brief Get bytes from the current (maybe unaligned) bit position.
+    void getBytes( char* pch, size_t unSize )
+    {
+      if( aligned() )
+      {
+        read(pch,unSize);
+        return;
+      }
+      // through the bit cache 64 bits at once
+      size_t i=0;
+      for( ; i+sizeof(T)<=unSize; i+=sizeof(T) )
+      {
+        T t;
+        get(t,sizeof(T)*8);
+        t = tbd::host2net(t);
+        memcpy(pch+i,&t,sizeof(T));
+      }
+      for( ; i<unSize; i++ )
+      {
+        unsigned char uch;
+        get(uch,8);
+        pch[i] = (char)uch;
+      }
+    }
+    /// @brief Read some bytes directly from the source stream.
+    __BITSTEAM_INLINE void readSource(char* psItems, size_t unNumBytes)
+    {
+      // contiguous sources lend their content without a read() call
+      const char* p = tbd::borrow(m_is,unNumBytes);
+      if( NULL != p )
+      {
+        memcpy(psItems,p,unNumBytes);
+        return;
+      }
+      m_is.read(psItems,unNumBytes);
+      if( unNumBytes != (size_t)m_is.gcount() )
+      {
+        set(0,0);
+        TBD_THROW(BitParseException(BitParseException::UnexpectedEndOfFile));
+      }
+    }
+    /// @brief Read up to unSize bytes from the source stream into the bit cache.
+    /// @details
+    /// The bit cache reads ahead, so it may hit the end of the source stream
+    /// before the content ends. This isn't an error of the source stream
+    /// (a std::istream would keep failing and refuse seekg()).
+    /// @return Number of bytes read.
+    __BITSTEAM_INLINE size_t readCache( char* pch, size_t unSize )
+    {
+      m_is.read(pch,unSize);
+      const size_t unRead = (size_t)m_is.gcount();
+      if( unRead < unSize )
+        details::clearEof(&m_is);
+      return unRead;
+    }
+  private:
+    /// @brief Source stream to read all content from.
+    I&            m_is;
+  };
+  /** @brief Bit input stream that reads from contiguous memory.
+   *  @details
+   *  Unlike BitIStream this stream doesn't pull bytes from a source stream on
+   *  demand. It keeps 64 bits of lookahead in the bit cache and refills it
+   *  with one unaligned big endian word load, so get(), peek() and skip()
+   *  mostly need shifts and masks only. Use it to parse content that is
+   *  completely in memory, like a MemIStream or a MmapIStream (see
+   *  IStream::window()).
+   *  @n The stream doesn't take ownership of the memory.
+   *  @ingroup BitStreams
+   */
+  template<class C=NulConfig>
+  class BitMemIStream
+    : public BitStream
+    , public C
+  {
+  public:
+    /** @brief Constructor
+     *  @param pch Begin of the memory to read.
+     *  @param unSize Size of the memory in bytes.
+     */
+    BitMemIStream( const char* pch, size_t unSize )
+      : m_pchBegin(pch), m_pchNext(pch), m_pchEnd(pch+unSize), m_bFail(false) {}
+    /** @brief Constructor that reads the memory lent by an input stream.
+     *  @details
+     *  Reads all content behind the read position of is (see
+     *  IStream::window()). The read position of is isn't changed, use
+     *  tbd::borrow() with tellg()/8 to move it behind the content that has
+     *  been read.
+     *  @param is Stream that stores its content contiguously in memory.
+     */
+    template<class SP> explicit BitMemIStream( const IStream<SP>& is )
+      : m_bFail(false)
+    {
+      size_t unSize;
+      m_pchBegin = m_pchNext = is.window(unSize);
+      m_pchEnd = m_pchBegin+unSize;
+      // the stream has to store its content contiguously
+      BOOST_ASSERT(NULL!=m_pchBegin || 0==unSize);
+    }
+    /// @brief Get one item of type S in network byte order and convert it
+    /// into host byte order.
+    template<class S> __BITSTEAM_INLINE void get( S& s ) { get(s,sizeof(S)*8); }
+    __BITSTEAM_INLINE void get( bool& b ) { b = 0 != bits(1); }
+    /// @brief Get some bits into the lower bits of an item of type S.
+    /// @param s Reference to the item that gets the result.
+    /// @param uCount Number of bits to read.
+    template<class S> __BITSTEAM_INLINE void get( S& s, const bit::Count& uCount )
+    {
+      // you have to copy at least one bit
+      BOOST_ASSERT( uCount>0 );
+      // you can't copy more bits than fit into type S
+      BOOST_ASSERT( uCount<=sizeof(S)*8 );
+      s = extend<S>(bits(uCount),uCount);
+    }
+    /// @brief Get some items of type S and convert them into host byte
+    /// order.
+    template<class S> __BITSTEAM_INLINE void getn( S* psItems, size_t unNumItems )
+    {
+      const char* p = aligned() ? borrow(unNumItems*sizeof(S)) : NULL;
+      if( NULL != p )
+        // copy and convert in one pass
+        tbd::net2host(psItems,p,unNumItems);
+      else
+        for( size_t i=0; i<unNumItems; i++ )
+        {
+          // the item's bit pattern (S might be a floating point type)
+          typename details::Uint<sizeof(S)>::type u;
+          get(u);
+          memcpy(psItems+i,&u,sizeof(S));
+        }
+    }
+    /** @brief Get some items of uBits bits each (see BitOStream::putBits()).
+     *  @details
+     *  If the stream is byte aligned groups of 8 items are unpacked by
+     *  bit::unpack() directly from the memory. Signed types get sign
+     *  extended.
+     *  @param psItems Pointer to the first item to fill.
+     *  @param unNumItems Number of items to get.
+     *  @param uBits Number of bits per item.
+     */
+    template<class S>
+    void getBits( S* psItems, size_t unNumItems, const bit::Count& uBits )
+    {
+      BOOST_ASSERT( uBits>0 && uBits<=sizeof(S)*8 );
+      size_t i=0;
+      // the unpack kernels take up to 32 bits
+      if( uBits <= 32 && unNumItems >= 8 )
+      {
+        const size_t unItems = unNumItems/8*8;
+        const char* p = aligned() ? borrow(unItems/8*uBits) : NULL;
+        if( NULL != p )
+          i = bit::unpack(psItems,p,unItems,(unsigned int)uBits);
+        else
+        {
+          char ach[PACK_ITEMS*4];
+          for( ; unNumItems-i >= 8; )
           {
-            set(0,0);
-            TBD_THROW(BitParseException(BitParseException::UnexpectedEndOfFile));
+            const size_t unChunk = std::min<size_t>(unNumItems-i,PACK_ITEMS)/8*8;
+            const size_t unBytes = unChunk/8*uBits;
+            size_t j=0;
+            // 32 bits at once, so each part stays within the lookahead
+            for( ; j+4<=unBytes; j+=4 )
+            {
+              boost::uint32_t u = tbd::host2net((boost::uint32_t)bits(32));
+              memcpy(ach+j,&u,4);
+            }
+            for( ; j<unBytes; j++ )
+              ach[j] = (char)bits(8);
+            i += bit::unpack(psItems+i,ach,unChunk,(unsigned int)uBits);
           }
         }
       }
+      for( ; i<unNumItems; i++ )
+        get(psItems[i],uBits);
+    }
+    /** @brief Get a unary code: count the cleared bits up to the next set
+     *  bit.
+     *  @return Number of cleared bits (the set bit is consumed too).
+     */
+    size_t getUnary()
+    {
+      size_t unZeros=0;
+      for(;;)
+      {
+        ensure(1);
+        // bits below count() belong to the following content, so look at
+        // the valid ones only
+        const size_t unLeading = sizeof(T)*8-bit::usedBits(current());
+        if( unLeading < count() )
+        {
+          unZeros += unLeading;
+          // consume the zeros and the set bit (never all 64 bits at once)
+          consume(unLeading);
+          consume(1);
+          return unZeros;
+        }
+        unZeros += count();
+        set(0,0);
+      }
+    }
+    /** @brief Get up to uCount bits without moving the read position.
+     *  @details
+     *  Missing bits at the end of the memory are cleared (see
+     *  BitIStream::lookahead()).
+     *  @return Number of bits that really are available (up to uCount).
+     */
+    template<class S> __BITSTEAM_INLINE size_t lookahead( S& s, const bit::Count& uCount )
+    {
+      BOOST_ASSERT( uCount>0 && uCount<=LOOKAHEAD && uCount<=sizeof(S)*8 );
+      if( uCount > count() )
+        refill();
+      // the cache holds cleared bits behind the end of the memory
+      s = (S)(current() >> (sizeof(T)*8-uCount));
+      return std::min<size_t>(count(),uCount);
+    }
+    /// @brief Get some bits without moving the read position.
+    template<class S> __BITSTEAM_INLINE void peek( S& s, const bit::Count& uCount )
+    {
+      BOOST_ASSERT( uCount>0 );
+      BOOST_ASSERT( uCount<=sizeof(S)*8 );
+      if( uCount <= LOOKAHEAD )
+      {
+        ensure(uCount);
+        s = extend<S>(current() >> (sizeof(T)*8-uCount),uCount);
+      }
       else
       {
-        // read the bytes directly from source stream
-        m_is.read(((char*)psItems),unNumBytes);
-        if( unNumBytes != (size_t)m_is.gcount() )
+        streampos pos=tellg();
+        get(s,uCount);
+        seekg(pos);
+      }
+    }
+    template<class S> __BITSTEAM_INLINE void peek( S& s ) { peek(s,sizeof(S)*8); }
+    __BITSTEAM_INLINE void peek( bool& b ) { char ch; peek(ch,1); b = ch!=0; }
+    /// @brief Skip some bits.
+    /// @param ullCount Number of bits to skip.
+    __BITSTEAM_INLINE void skip( streampos ullCount )
+    {
+      // the cache may be full, which consume() can't shift out
+      if( ullCount < (streampos)count() )
+        consume((size_t)ullCount);
+      else
+        seekg(tellg()+ullCount);
+    }
+    void align( const bit::Count& uCount=8 )
+    {
+      streampos disalignment=tellg() % uCount;
+      if( disalignment > 0 )
+        skip(uCount-disalignment);
+    }
+    /// @brief Return the current read bit position of this stream.
+    streampos tellg() const { return (streampos)(m_pchNext-m_pchBegin)*8-count(); }
+    /// @brief Set the current read bit position of this stream.
+    void seekg( streampos ullPos )
+    {
+      if( ullPos < 0 || ullPos > (streampos)(m_pchEnd-m_pchBegin)*8 )
+      {
+        m_bFail = true;
+        TBD_THROW(BitParseException(BitParseException::UnexpectedEndOfFile));
+      }
+      set(0,0);
+      m_pchNext = m_pchBegin+(size_t)(ullPos/8);
+      if( 0 < ullPos%8 )
+        bits((size_t)(ullPos%8));
+    }
+    void seekg2end() { set(0,0); m_pchNext = m_pchEnd; }
+    virtual bool fail() const { return m_bFail; }
+    /** @brief Borrow some bytes without copying.
+     *  @attention This method crashes with assertion if this bit stream
+     *  isn't byte aligned!
+     *  @return Pointer to unNumBytes bytes or NULL if there aren't enough.
+     */
+    const char* borrow( size_t unNumBytes )
+    {
+      BOOST_ASSERT( aligned() );
+      // give the bytes in the bit cache back
+      const char* p = m_pchNext-count()/8;
+      if( unNumBytes > (size_t)(m_pchEnd-p) )
+        return NULL;
+      set(0,0);
+      m_pchNext = p+unNumBytes;
+      return p;
+    }
+    __BITSTEAM_INLINE BitMemIStream& operator>>( bool& rb )                  { get(rb);    return *this; }
+    __BITSTEAM_INLINE BitMemIStream& operator>>( char& rch )                 { get(rch);   return *this; }
+    __BITSTEAM_INLINE BitMemIStream& operator>>( unsigned char& ruch )       { get(ruch);  return *this; }
+    __BITSTEAM_INLINE BitMemIStream& operator>>( short& rs )                 { get(rs);    return *this; }
+    __BITSTEAM_INLINE BitMemIStream& operator>>( unsigned short& rus )       { get(rus);   return *this; }
+    __BITSTEAM_INLINE BitMemIStream& operator>>( long& rl )                  { get(rl);    return *this; }
+    __BITSTEAM_INLINE BitMemIStream& operator>>( unsigned long& rul )        { get(rul);   return *this; }
+    __BITSTEAM_INLINE BitMemIStream& operator>>( long long& rll )            { get(rll);   return *this; }
+    __BITSTEAM_INLINE BitMemIStream& operator>>( unsigned long long& rull )  { get(rull);  return *this; }
+    __BITSTEAM_INLINE BitMemIStream& operator>>( int& rn )                   { get(rn);    return *this; }
+    __BITSTEAM_INLINE BitMemIStream& operator>>( unsigned int& run )         { get(run);   return *this; }
+    __BITSTEAM_INLINE BitMemIStream& operator>>( std::string& str )
+    {
+      str.clear();
+      char ch;
+      for( get(ch); ch!='\0'; get(ch) )
+        str += ch;
+      return *this;
+    }
+    template<class S> __BITSTEAM_INLINE BitMemIStream& operator>>( std::pair<std::string*,S> pairStr )
+    {
+      // if size parameter equals max(S)
+      if( pairStr.second == bit::bitmask<S>() )
+        // get size from stream
+        get(pairStr.second);
+      const char* psz = (aligned() && pairStr.second > 0) ? borrow(pairStr.second) : NULL;
+      if( NULL != psz )
+        pairStr.first->assign(psz,pairStr.second);
+      else
+      {
+        pairStr.first->resize(pairStr.second);
+        for( S i=0; i<pairStr.second; i++ )
+          get((*pairStr.first)[i]);
+      }
+      return *this;
+    }
+    template<class S> __BITSTEAM_INLINE
+      BitMemIStream& operator>>( std::pair<S*,bit::Count> rbits )
+    { get(*rbits.first,rbits.second); return *this; }
+    __BITSTEAM_INLINE
+      BitMemIStream& operator>>( std::pair<void*,bit::Count> rbits )
+    { skip(rbits.second); return *this; }
+  protected:
+    enum
+    {
+      /// @brief Number of bits that are always available after a refill
+      ///        (unless the end of the memory is near).
+      LOOKAHEAD = 56,
+      /// @brief Number of items getBits() unpacks at once.
+      PACK_ITEMS = 512
+    };
+    /// @brief Get up to 64 bits (MSB first) as unsigned value.
+    __BITSTEAM_INLINE T bits( size_t uCount )
+    {
+      if( uCount > LOOKAHEAD )
+      {
+        // two parts, so neither shift reaches the register size
+        const size_t uLow = uCount-32;
+        const T tHigh = bits(32);
+        return (tHigh << uLow) | bits(uLow);
+      }
+      ensure(uCount);
+      const T t = current() >> (sizeof(T)*8-uCount);
+      consume(uCount);
+      return t;
+    }
+    /// @brief Make sure that there are at least uCount bits in the cache.
+    __BITSTEAM_INLINE void ensure( size_t uCount )
+    {
+      if( uCount > count() )
+      {
+        refill();
+        if( uCount > count() )
         {
-          set(0,0);
+          m_bFail = true;
           TBD_THROW(BitParseException(BitParseException::UnexpectedEndOfFile));
         }
       }
     }
+    /// @brief Remove uCount bits from the cache.
+    __BITSTEAM_INLINE void consume( size_t uCount )
+    {
+      BOOST_ASSERT( uCount<=count() && uCount<sizeof(T)*8 );
+      current() <<= uCount;
+      subCount(uCount);
+    }
+    /// @brief Fill the cache up to at least LOOKAHEAD bits.
+    /// @details
+    /// The cache holds the next bits MSB aligned. The bits below count()
+    /// already hold the following content of the memory, so loading them
+    /// again doesn't change them.
+    __BITSTEAM_INLINE void refill()
+    {
+      const size_t uCount = count();
+      if( m_pchEnd-m_pchNext >= (ptrdiff_t)sizeof(T) )
+      {
+        T t;
+        memcpy(&t,m_pchNext,sizeof(T));
+        current() |= tbd::net2host(t) >> uCount;
+        m_pchNext += (sizeof(T)*8-1-uCount)/8;
+        setCount(uCount | LOOKAHEAD);
+      }
+      else
+      {
+        // near the end byte by byte
+        size_t u = uCount;
+        for( ; u <= LOOKAHEAD && m_pchNext < m_pchEnd; u += 8 )
+          current() |= (T)(unsigned char)*m_pchNext++ << (LOOKAHEAD-u);
+        setCount(u);
+      }
+    }
+    /// @brief Sign extend or clear the bits above uCount.
+    template<class S> static __BITSTEAM_INLINE S extend( T t, size_t uCount )
+    {
+      if( uCount < sizeof(T)*8 && bit::is_type_signed<S>() && 0 != (t & ((T)1 << (uCount-1))) )
+        t |= ~(T)0 << uCount;
+      return (S)t;
+    }
   private:
-    /// @brief Source stream to read all content from.
-    I&            m_is;
+    /// @brief Begin of the memory.
+    const char*   m_pchBegin;
+    /// @brief Next byte to load into the bit cache.
+    const char*   m_pchNext;
+    /// @brief End of the memory.
+    const char*   m_pchEnd;
+    bool          m_bFail;
   };
   /// @brief Generates a pair of a NULL pointer and a bit count.
   /// @details
@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////////
+/// @file domarena.h
+/// @brief Monotonic memory pool for DOM documents
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TBD__DOMARENA_H
+#define __TBD__DOMARENA_H
+
+#include <boost/assert.hpp>
+#include "domsymbols.h"
+#include <stddef.h>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace tbd
+{
+  /** @brief Monotonic memory pool of a DOM document.
+   *  @details
+   *  Memory is taken from large blocks by moving a pointer. Single
+   *  allocations are never freed, all blocks are released at once when the
+   *  arena is destroyed. Nodes, child arrays, values and payloads of a
+   *  document that uses an arena (see DomStream::arena()) come from it, so
+   *  building and destroying a document doesn't call malloc/free per node.
+   *  @n The names of the nodes are interned in the symbols() of the arena,
+   *  so they are released with the document as well.
+   *  @attention Memory of grown child arrays isn't reused before the arena
+   *             is destroyed.
+   *  @ingroup DomStreams
+   */
+  class DomArena
+  {
+  public:
+    enum
+    {
+      /// @brief Default size of a block.
+      BLOCK_SIZE = 64*1024,
+      /// @brief Default alignment of allocations.
+      ALIGNMENT = 16
+    };
+    /// @brief Constructor
+    /// @param unBlockSize Size of the blocks to allocate.
+    explicit DomArena( size_t unBlockSize=BLOCK_SIZE )
+      : m_pchNext(NULL), m_pchEnd(NULL), m_unBlockSize(unBlockSize), m_unBytes(0)
+    {}
+    /// @brief Destructor releases all blocks.
+    ~DomArena()
+    {
+      for( size_t i=0; i<m_blocks.size(); i++ )
+        delete[] m_blocks[i];
+    }
+    /** @brief Allocates memory from the current block.
+     *  @param unSize Number of bytes.
+     *  @param unAlignment Alignment (power of 2).
+     *  @return Pointer to the memory.
+     */
+    void* allocate( size_t unSize, size_t unAlignment=ALIGNMENT )
+    {
+      BOOST_ASSERT( 0 < unAlignment && 0 == (unAlignment & (unAlignment-1)) );
+      char* p = align(m_pchNext,unAlignment);
+      if( NULL == m_pchNext || unSize > (size_t)(m_pchEnd-p) )
+      {
+        // large allocations get their own block and leave the current one
+        // alone
+        if( unSize+unAlignment > m_unBlockSize/4 )
+        {
+          m_blocks.push_back(new char[unSize+unAlignment]);
+          m_unBytes += unSize;
+          return align(m_blocks.back(),unAlignment);
+        }
+        m_blocks.push_back(new char[m_unBlockSize]);
+        m_pchNext = m_blocks.back();
+        m_pchEnd = m_pchNext+m_unBlockSize;
+        p = align(m_pchNext,unAlignment);
+      }
+      m_pchNext = p+unSize;
+      m_unBytes += unSize;
+      return p;
+    }
+    /// @brief Returns the number of allocated bytes.
+    size_t bytes() const { return m_unBytes; }
+    /// @brief Returns the number of blocks.
+    size_t blocks() const { return m_blocks.size(); }
+    /// @brief Returns the table of the node names.
+    DomSymbols& symbols() { return m_symbols; }
+  private:
+    DomArena( const DomArena& );
+    DomArena& operator=( const DomArena& );
+    static char* align( char* p, size_t unAlignment )
+    {
+      return (char*)(((size_t)p + unAlignment-1) & ~(unAlignment-1));
+    }
+    /// @brief All blocks.
+    std::vector<char*>    m_blocks;
+    /// @brief Free memory of the current block.
+    char*                 m_pchNext;
+    char*                 m_pchEnd;
+    size_t                m_unBlockSize;
+    size_t                m_unBytes;
+    /// @brief Names of the nodes in this arena.
+    DomSymbols            m_symbols;
+  };
+
+  /** @brief Allocator that takes its memory from a DomArena.
+   *  @details
+   *  Without an arena the memory comes from the heap as usual.
+   *  Deallocation of arena memory does nothing.
+   *  @ingroup DomStreams
+   */
+  template<class T> class DomAllocator
+  {
+  public:
+    typedef T               value_type;
+    typedef T*              pointer;
+    typedef const T*        const_pointer;
+    typedef T&              reference;
+    typedef const T&        const_reference;
+    typedef size_t          size_type;
+    typedef ptrdiff_t       difference_type;
+    template<class U> struct rebind { typedef DomAllocator<U> other; };
+
+    DomAllocator( DomArena* pArena=NULL ) : m_pArena(pArena) {}
+    template<class U> DomAllocator( const DomAllocator<U>& other ) : m_pArena(other.arena()) {}
+    pointer allocate( size_type n, const void* =NULL )
+    {
+      if( NULL != m_pArena )
+        return (pointer)m_pArena->allocate(n*sizeof(T),1==sizeof(T)?1:DomArena::ALIGNMENT);
+      return (pointer)::operator new(n*sizeof(T));
+    }
+    void deallocate( pointer p, size_type )
+    {
+      // arena memory is released with the arena
+      if( NULL == m_pArena )
+        ::operator delete(p);
+    }
+    void construct( pointer p, const T& t ) { new((void*)p) T(t); }
+    void destroy( pointer p ) { p->~T(); }
+    size_type max_size() const { return (size_type)-1/sizeof(T); }
+    pointer address( reference r ) const { return &r; }
+    const_pointer address( const_reference r ) const { return &r; }
+    DomArena* arena() const { return m_pArena; }
+    template<class U> bool operator==( const DomAllocator<U>& other ) const { return m_pArena == other.arena(); }
+    template<class U> bool operator!=( const DomAllocator<U>& other ) const { return m_pArena != other.arena(); }
+  private:
+    DomArena* m_pArena;
+  };
+  /// @brief String whose memory may come from a DomArena.
+  /// @ingroup DomStreams
+  typedef std::basic_string<char,std::char_traits<char>,DomAllocator<char> > DomString;
+}
+
+#endif
@@ -19,9 +19,20 @@
 #include <boost/ptr_container/ptr_list.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/foreach.hpp>
+#include <unordered_map>
+#include <type_traits>
+#include <climits>
+#include <limits>
+#include <cmath>
+#include <locale>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include "debug_assert.h"
 #include "exception.h"
 #include "dump.h"
+#include "domarena.h"
+#include "domsymbols.h"
 #include <iostream>
 
 //#define TBD_LOG_DOMSTREAM_OPERATIONS(x) std::cout << x << std::endl
@@ -95,17 +106,72 @@ namespace tbd
    *  A node is specified as an item in a tree. So every node itself can have
    *  zero to n children. These children are stored in the base class
    *  std::vector<DomNode*>.
+   *  @n Nodes that are created in a DomArena (see DomStream::arena()) take
+   *  their children array, value and index from the arena too.
+   *  @n Names are stored as DomSymbol of symbols(), so children are found by
+   *  comparing symbols instead of strings. Nodes with at least INDEX_THRESHOLD
+   *  children build an index of the children's positions per name on the
+   *  first lookup, so find() doesn't scan them.
+   *  @attention The index follows push_back(), erase(), setName() and
+   *             setSymbol(). Call dropIndex() after inserting, removing or
+   *             replacing children with the std::vector methods.
    */
-  class DomNode : public std::vector<DomNode*>
+  class DomNode : public std::vector<DomNode*,DomAllocator<DomNode*> >
   {
-    typedef std::vector<DomNode*> base;
+    typedef std::vector<DomNode*,DomAllocator<DomNode*> > base;
   public:
-    /// @brief Standard constructor.
-    DomNode(const DomCommand& command);
+    enum
+    {
+      /// @brief Number of children from which on find() uses an index.
+      INDEX_THRESHOLD = 32
+    };
+    /** @brief Standard constructor.
+     *  @param command Command that creates the node.
+     *  @param pArena Arena the node is allocated in or NULL if it is
+     *         allocated with new.
+     */
+    DomNode(const DomCommand& command, DomArena* pArena=NULL);
     /// @brief Destructor clears all children.
     virtual ~DomNode() {
+      // children in an owned arena are released with it at once
+      if( m_bArenaOwner )
+      {
+        delete m_pArena;
+        return;
+      }
+      dropIndex();
       for( iterator it=begin(); it!=end(); ++it )
-        delete *it;
+        destroy(*it);
+    }
+    /** @brief Destroys a node that was created by createNode().
+     *  @details
+     *  Nodes in an arena are destructed only, their memory is released with
+     *  the arena.
+     */
+    static void destroy( DomNode* pNode )
+    {
+      if( NULL != pNode->m_pArena && !pNode->m_bArenaOwner )
+        pNode->~DomNode();
+      else
+        delete pNode;
+    }
+    /// @brief Returns the arena this node and its children are allocated in
+    ///        or NULL.
+    DomArena* arena() const { return m_pArena; }
+    /** @brief Lets this (root) node create all further nodes in an arena.
+     *  @details
+     *  The node takes the ownership of the arena and releases it with all
+     *  nodes in it in its destructor.
+     *  @param pArena The arena or NULL to create nodes with new again.
+     *  @attention Only possible as long as this node has no children.
+     */
+    void adopt( DomArena* pArena )
+    {
+      BOOST_ASSERT( empty() && (NULL == m_pArena || m_bArenaOwner) );
+      if( m_bArenaOwner )
+        delete m_pArena;
+      m_pArena = pArena;
+      m_bArenaOwner = NULL != pArena;
     }
     std::string getPath() const { if( NULL != getParent() ) return getParent()->getPath() + "/" + getName(); else return getName(); }
     /** @brief Return the parent node.
@@ -120,11 +186,39 @@ namespace tbd
     /** @brief Get the name of this node as const.
      *  @return Name of the node as const reference.
      */
-    const std::string& getName() const { return m_strName; }
+    const std::string& getName() const { return m_symbol.name(); }
     /** @brief Set the name of this node.
      *  @param strName New name of this node.
      */
-    void setName( const std::string& strName ) { m_strName = strName; }
+    void setName( const std::string& strName ) { setSymbol(symbols().intern(strName)); }
+    /// @brief Returns the table the names of this node and its children are
+    ///        interned in (the one of the arena or the global one).
+    DomSymbols& symbols() const { return NULL != m_pArena ? m_pArena->symbols() : DomSymbols::global(); }
+    /// @brief Returns the interned name of this node.
+    DomSymbol getSymbol() const { return m_symbol; }
+    /// @brief Set the interned name of this node.
+    /// @details Symbols of other tables are interned in symbols() by name.
+    void setSymbol( DomSymbol symbol )
+    {
+      if( !symbol.empty() && symbol.symbols() != &symbols() )
+        symbol = symbols().intern(symbol.name());
+      // the parent's index knows the old name
+      if( NULL != m_pParent && symbol != m_symbol )
+        m_pParent->dropIndex();
+      m_symbol = symbol;
+    }
+    /// @brief Drops the index of the children (see INDEX_THRESHOLD).
+    void dropIndex()
+    {
+      if( NULL == m_pIndex )
+        return;
+      // an index in the arena is destructed only
+      if( NULL != m_pArena )
+        m_pIndex->~Index();
+      else
+        delete m_pIndex;
+      m_pIndex = NULL;
+    }
     EDomCommandCode getCommandCode() const { return m_eCommandCode; }
     DomCommandFlags getFlags() const { return m_nDomCommandFlags; }
     bool isAttribute() const { return getCommandCode() == ATTRIBUTE; }
@@ -133,26 +227,63 @@ namespace tbd
     bool isMissing() const { return 0 != (getFlags() & MISSING); }
     void miss() { m_nDomCommandFlags |= MISSING; }
     void hide() { m_nDomCommandFlags |= HIDDEN; }
-    /// @brief override this method to control value store
+    /// @brief Type of the value of a node.
+    enum EValueType
+    {
+      /// @brief The node has no value.
+      NO_VALUE,
+      /// @brief Signed integer.
+      INT_VALUE,
+      /// @brief Unsigned integer.
+      UINT_VALUE,
+      /// @brief Floating point number.
+      FLOAT_VALUE,
+      /// @brief Boolean.
+      BOOL_VALUE,
+      /// @brief Text.
+      STRING_VALUE,
+      /// @brief Binary object only (see set(const void*,size_t)).
+      BINARY_VALUE
+    };
+    /// @brief Returns the type of the value.
+    EValueType getValueType() const
+    { return NO_VALUE == m_eValueType && m_unBinaryDataSize > 0 ? BINARY_VALUE : m_eValueType; }
+    /// @brief Returns true if the node has no value (getValueStr() is
+    ///        empty).
+    bool emptyValue() const { return NO_VALUE == getValueType(); }
+    /** @brief Returns the value as text.
+     *  @details
+     *  Numbers and booleans are stored typed and formatted not before they
+     *  are needed as text. The format is the same as of std::ostream.
+     */
     std::string getValueStr() const
     {
+      if( NO_VALUE != m_eValueType && STRING_VALUE != m_eValueType )
+      {
+        char ach[FORMAT_SIZE];
+        return std::string(ach,format(ach,m_eValueType,m_value));
+      }
       if( m_strValue.empty() && m_unBinaryDataSize > 0 )
       {
         std::stringstream ss;
         ss << dump::hex_ascii(m_pchBinaryData,m_unBinaryDataSize);
         return ss.str();
       }
-      return m_strValue;
+      return std::string(m_strValue.data(),m_strValue.size());
     }
     /// @brief override this method to control value restore
-    void setValueStr( const std::string& str ) { m_strValue = str; }
+    void setValueStr( const std::string& str )
+    {
+      m_strValue.assign(str.data(),str.size());
+      m_eValueType = m_strValue.empty() ? NO_VALUE : STRING_VALUE;
+    }
     void setValueBinary( const char* pchBinaryData, size_t nBinaryDataSize ) { m_pchBinaryData = pchBinaryData; m_unBinaryDataSize = nBinaryDataSize; }
     void getValueBinary( const char*& rpchBinaryData, size_t& rnBinaryDataSize ) const { rpchBinaryData = m_pchBinaryData; rnBinaryDataSize = m_unBinaryDataSize; }
     const char* getBinaryBuffer() const { return m_pchBinaryData; }
     size_t getBinarySize() const { return m_unBinaryDataSize; }
     bool isBinary() const { return m_unBinaryDataSize > 0; }
-    void setIndex( const std::string& strIndex ) { m_strIndex = strIndex; }
-    const std::string& getIndex() const { return m_strIndex; }
+    void setIndex( const std::string& strIndex ) { m_strIndex.assign(strIndex.data(),strIndex.size()); }
+    std::string getIndex() const { return std::string(m_strIndex.data(),m_strIndex.size()); }
     bool hasOnlyAttributes() const
     {
       BOOST_FOREACH( DomNode* node, *this)
@@ -180,6 +311,27 @@ namespace tbd
      */
     iterator find( const std::string& strName, iterator& it )
     {
+      DomSymbol symbol;
+      // no node can have an unknown name
+      if( !symbols().find(strName,symbol) )
+      {
+        it = end();
+        return end();
+      }
+      return find(symbol,it);
+    }
+    /** @brief Find first child with a specified interned name starting from a
+     *         given position.
+     *  @details See find(const std::string&,iterator&). Symbols of other
+     *  tables than symbols() are looked up by name.
+     */
+    iterator find( DomSymbol symbol, iterator& it )
+    {
+      if( !symbol.empty() && symbol.symbols() != &symbols() )
+        return find(symbol.name(),it);
+      // large nodes look up the positions
+      if( Positions* pPositions = index(symbol) )
+        return find(*pPositions,it);
       // result iterator
       iterator itResult=end();
       {
@@ -190,7 +342,7 @@ namespace tbd
           while( it!=end() )
           {
             // check if the name matches
-            if( (*it)->getName() == strName )
+            if( (*it)->m_symbol == symbol )
             {
               // store result
               itResult = it;
@@ -205,7 +357,7 @@ namespace tbd
         {
           // search for the next occurrence of the given name. Usually after a
           // find() call this will be exactly the next find position.
-          while( it != end() && (*it)->getName() != strName )
+          while( it != end() && (*it)->m_symbol != symbol )
             it++;
 
           // didn't found anything?
@@ -226,7 +378,7 @@ namespace tbd
           // set iterator 'it' to the position before the next occurrence of the
           // searched name. So that it++ has to be called from outside to set it
           // to the next find position (which might by end()).
-          while( (it+1) != end() && (*(it+1))->getName() != strName )
+          while( (it+1) != end() && (*(it+1))->m_symbol != symbol )
             it++;
         }
       }
@@ -238,6 +390,12 @@ namespace tbd
      *          found.
      */
     iterator find( const std::string& strName ) { iterator it=begin(); return find(strName,it); }
+    /** @brief Find first child with a specified interned name.
+     *  @param symbol Name to search for
+     *  @return Returns a pointer to the node or NULL if no such node has been
+     *          found.
+     */
+    iterator find( DomSymbol symbol ) { iterator it=begin(); return find(symbol,it); }
     /** @brief Append one new node to this node's children.
      *  @details
      *  In addition to vector<DomNode*>::push_back() this method sets the parent
@@ -253,8 +411,10 @@ namespace tbd
     }
     void erase(DomNode* pNode)
     {
-      delete pNode;
-      std::vector<DomNode*>::erase(std::find(begin(), end(), pNode));
+      destroy(pNode);
+      base::erase(std::find(begin(), end(), pNode));
+      // positions behind pNode have changed
+      dropIndex();
     }
     unsigned int attributes()
     {
@@ -284,63 +444,72 @@ namespace tbd
      *  You must overwrite this method to create the type of node you wish the
      *  DOM to use. Every node that will be created by the DOM will be created
      *  by using this method.
+     *  @n If this node has an arena the new node is created in it.
      */
-    DomNode* createNode(const DomCommand& command) const { return new DomNode(command); }
+    virtual DomNode* createNode(const DomCommand& command) const
+    {
+      if( NULL != m_pArena )
+        return new (m_pArena->allocate(sizeof(DomNode))) DomNode(command,m_pArena);
+      return new DomNode(command);
+    }
     /// @brief Store a boolean in this node
-    void set( const bool& b ) { setBoolValue(b); }
+    virtual void set( const bool& b ) { setBoolValue(b); }
     /// @brief Store a char in this node
-    void set( const char& ch ) { setValue((int)ch); }
+    virtual void set( const char& ch ) { setValue((int)ch); }
     /// @brief Store a unsigned char in this node
-    void set( const unsigned char& uch ) { setValue((unsigned int)uch); }
+    virtual void set( const unsigned char& uch ) { setValue((unsigned int)uch); }
     /// @brief Store a short in this node
-    void set( const short& s ) { setValue(s); }
+    virtual void set( const short& s ) { setValue(s); }
     /// @brief Store a unsigned short in this node
-    void set( const unsigned short& us ) { setValue(us); }
+    virtual void set( const unsigned short& us ) { setValue(us); }
     /// @brief Store a long in this node
-    void set( const long& l ) { setValue(l); }
+    virtual void set( const long& l ) { setValue(l); }
     /// @brief Store a unsigned long in this node
-    void set( const unsigned long& ul ) { setValue(ul); }
+    virtual void set( const unsigned long& ul ) { setValue(ul); }
     /// @brief Store a long long in this node
-    void set( const long long& ll ) { setValue(ll); }
+    virtual void set( const long long& ll ) { setValue(ll); }
     /// @brief Store a unsigned long long in this node
-    void set( const unsigned long long& ull ) { setValue(ull); }
+    virtual void set( const unsigned long long& ull ) { setValue(ull); }
     /// @brief Store an integer in this node
-    void set( const int& n ) { setValue(n); }
+    virtual void set( const int& n ) { setValue(n); }
     /// @brief Store an unsigned integer in this node
-    void set( const unsigned int& un ) { setValue(un); }
+    virtual void set( const unsigned int& un ) { setValue(un); }
     /// @brief Store a double in this node
-    void set( const double& d ) { setValue(d); }
+    virtual void set( const double& d ) { setValue(d); }
     /// @brief Store a string in this node
-    void set( const std::string& str ) { setValue(str); }
+    virtual void set( const std::string& str ) { setValue(str); }
     /// @brief Store a binary object in this node
-    void set( const void* p, size_t bytes ) { m_pchBinaryData=(char*)p; m_unBinaryDataSize=bytes; }
+    virtual void set( const void* p, size_t bytes ) { m_pchBinaryData=(char*)p; m_unBinaryDataSize=bytes; }
     /// @brief Read a boolean out of this node
-    void get( bool& b ) const { getBoolValue(b); }
+    virtual void get( bool& b ) const { getBoolValue(b); }
     /// @brief Read a char out of this node
-    void get( char& rch ) const { getValue(rch); }
+    virtual void get( char& rch ) const { getValue(rch); }
     /// @brief Read a unsigned char out of this node
-    void get( unsigned char& ruch ) const { getValue(ruch); }
+    virtual void get( unsigned char& ruch ) const { getValue(ruch); }
     /// @brief Read a short out of this node
-    void get( short& rs ) const { getValue(rs); }
+    virtual void get( short& rs ) const { getValue(rs); }
     /// @brief Read a unsigned short out of this node
-    void get( unsigned short& rus ) const { getValue(rus); }
+    virtual void get( unsigned short& rus ) const { getValue(rus); }
     /// @brief Read a long out of this node
-    void get( long& rl ) const { getValue(rl); }
+    virtual void get( long& rl ) const { getValue(rl); }
     /// @brief Read a unsigned long out of this node
-    void get( unsigned long& rul ) const { getValue(rul); }
+    virtual void get( unsigned long& rul ) const { getValue(rul); }
     /// @brief Read a long long out of this node
-    void get( long long& rll ) const { getValue(rll); }
+    virtual void get( long long& rll ) const { getValue(rll); }
     /// @brief Read a unsigned long long out of this node
-    void get( unsigned long long& rull ) const { getValue(rull); }
+    virtual void get( unsigned long long& rull ) const { getValue(rull); }
     /// @brief Read an integer out of this node
-    void get( int& rn ) const { getValue(rn); }
+    virtual void get( int& rn ) const { getValue(rn); }
     /// @brief Read an unsigned integer out of this node
-    void get( unsigned int& run ) const { getValue(run); }
+    virtual void get( unsigned int& run ) const { getValue(run); }
     /// @brief Read a double out of this node
-    void get( double& rd ) const { getValue(rd); }
+    virtual void get( double& rd ) const { getValue(rd); }
     /// @brief Read a string out of this node
-    void get( std::string& rstr ) const { rstr = getValueStr(); }
+    virtual void get( std::string& rstr ) const { rstr = getValueStr(); }
     /// @brief Read an binary object out of this node
+    /// @details Refers to the binary data of this node, which stays owned by
+    /// it. Not virtual, so derived nodes that return copies (BinNode) don't
+    /// hand out memory through this interface.
     void get( void*& p, size_t& bytes ) const { p=(void*)m_pchBinaryData; bytes=m_unBinaryDataSize; }
     void* data() const { return m_pData; }
     void data(void* pData) { m_pData = pData; }
@@ -352,14 +521,47 @@ namespace tbd
                   m_pData)));
     }
   protected:
-    void setBoolValue( bool b )                     { std::stringstream ss; ss << getValueStr() << (b ? "1" : "0"); setValueStr(ss.str()); }
-    template<class T> void setValue( const T& t )   { std::stringstream ss; ss << getValueStr() << t; setValueStr(ss.str()); }
-    void setValue( const char& ch )                 { std::stringstream ss; ss << getValueStr() << (int)ch; setValueStr(ss.str()); }
-    void setValue( const unsigned char& uch )       { std::stringstream ss; ss << getValueStr() << (unsigned int)uch; setValueStr(ss.str()); }
-    template<class T> void getValue( T& rt ) const  { std::stringstream ss(getValueStr()); ss >> rt; }
-    void getValue( char& rch ) const                { int i; std::stringstream ss(getValueStr()); ss >> i; rch = (char)i; }
-    void getValue( unsigned char& ruch ) const      { unsigned int u; std::stringstream ss(getValueStr()); ss >> u; ruch=(unsigned char)u; }
-    void getBoolValue( bool& rb ) const             { rb = 0 != strtoul(getValueStr().c_str(),NULL,10); }
+    /// @brief Typed value.
+    union Value
+    {
+      long long           ll;
+      unsigned long long  ull;
+      double              d;
+      bool                b;
+    };
+    void setBoolValue( bool b )                     { Value v; v.b = b; setValue(BOOL_VALUE,v); }
+    template<class T> typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+      setValue( const T& t )                        { Value v; v.ll = t; setValue(INT_VALUE,v); }
+    template<class T> typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+      setValue( const T& t )                        { Value v; v.ull = t; setValue(UINT_VALUE,v); }
+    template<class T> typename std::enable_if<std::is_floating_point<T>::value>::type
+      setValue( const T& t )                        { Value v; v.d = t; setValue(FLOAT_VALUE,v); }
+    template<class T> typename std::enable_if<!std::is_arithmetic<T>::value>::type
+      setValue( const T& t )                        { std::stringstream ss; ss << t; appendValue(ss.str()); }
+    void setValue( const std::string& str )         { appendValue(str); }
+    template<class T> typename std::enable_if<std::is_arithmetic<T>::value>::type getValue( T& rt ) const
+    {
+      switch( m_eValueType )
+      {
+      case INT_VALUE:   rt = (T)m_value.ll;  break;
+      case UINT_VALUE:  rt = (T)m_value.ull; break;
+      case FLOAT_VALUE: rt = (T)m_value.d;   break;
+      case BOOL_VALUE:  rt = (T)m_value.b;   break;
+      default:          parseValue(rt);      break;
+      }
+    }
+    template<class T> typename std::enable_if<!std::is_arithmetic<T>::value>::type
+      getValue( T& rt ) const                       { std::stringstream ss(getValueStr()); ss >> rt; }
+    void getBoolValue( bool& rb ) const
+    {
+      switch( m_eValueType )
+      {
+      case INT_VALUE:   rb = 0 != m_value.ll;  break;
+      case UINT_VALUE:  rb = 0 != m_value.ull; break;
+      case BOOL_VALUE:  rb = m_value.b;        break;
+      default:          { bool bNegative; rb = 0 != parse(getValueStr(),bNegative); } break;
+      }
+    }
     /** @brief dump the value as human readable.
      *  @details
      *  The content should be written in one single line!
@@ -367,17 +569,259 @@ namespace tbd
      */
     void dumpValue( std::ostream& os ) { os << " = " << getValueStr(); }
   private:
+    enum
+    {
+      /// @brief Maximum size of a formatted value.
+      FORMAT_SIZE = 32
+    };
+    /// @brief Stores a typed value or appends its text to an existing value.
+    void setValue( EValueType eType, const Value& value )
+    {
+      if( emptyValue() )
+      {
+        m_eValueType = eType;
+        m_value = value;
+        return;
+      }
+      char ach[FORMAT_SIZE];
+      appendValue(std::string(ach,format(ach,eType,value)));
+    }
+    /// @brief Appends text to the value.
+    void appendValue( const std::string& str )
+    {
+      // the text of a typed or binary value is the beginning
+      if( STRING_VALUE != m_eValueType && !emptyValue() )
+      {
+        const std::string strValue = getValueStr();
+        m_strValue.assign(strValue.data(),strValue.size());
+      }
+      m_strValue.append(str.data(),str.size());
+      m_eValueType = m_strValue.empty() ? NO_VALUE : STRING_VALUE;
+    }
+    // the text is parsed and formatted independently of the C locale
+    // (setlocale() may have set another decimal point), like std::ostream
+    // in the classic locale does
+    template<class T> typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+      parseValue( T& rt ) const
+    {
+      bool bNegative;
+      const unsigned long long ull = parse(getValueStr(),bNegative);
+      if( bNegative )
+        rt = (T)(ull > 1ULL+(unsigned long long)LLONG_MAX ? LLONG_MIN : (long long)(0ULL-ull));
+      else
+        rt = (T)(ull > (unsigned long long)LLONG_MAX ? LLONG_MAX : (long long)ull);
+    }
+    template<class T> typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+      parseValue( T& rt ) const
+    {
+      bool bNegative;
+      const unsigned long long ull = parse(getValueStr(),bNegative);
+      rt = (T)(bNegative ? 0ULL-ull : ull);
+    }
+    template<class T> typename std::enable_if<std::is_floating_point<T>::value>::type
+      parseValue( T& rt ) const
+    {
+      const std::string str = getValueStr();
+      std::istringstream ss(str);
+      ss.imbue(std::locale::classic());
+      double d=0;
+      if( !(ss >> d) )
+      {
+        // the stream doesn't read back what it writes for non-finite values
+        const char* p = str.c_str();
+        while( ' ' == *p || ('\t' <= *p && *p <= '\r') )
+          p++;
+        const bool bNegative = '-' == *p;
+        if( '-' == *p || '+' == *p )
+          p++;
+        if( 0 == strncmp(p,"inf",3) )
+          d = bNegative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+        else if( 0 == strncmp(p,"nan",3) )
+          d = std::numeric_limits<double>::quiet_NaN();
+        else
+          d = 0;
+      }
+      rt = (T)d;
+    }
+    /// @brief Parses a decimal integer (leading white space and sign like
+    ///        strtoull()) and returns its magnitude (saturated).
+    static unsigned long long parse( const std::string& str, bool& rbNegative )
+    {
+      const char* p = str.c_str();
+      while( ' ' == *p || ('\t' <= *p && *p <= '\r') )
+        p++;
+      rbNegative = '-' == *p;
+      if( '-' == *p || '+' == *p )
+        p++;
+      unsigned long long ull = 0;
+      for( ; '0' <= *p && *p <= '9'; p++ )
+      {
+        const unsigned int uDigit = (unsigned int)(*p-'0');
+        if( ull > (ULLONG_MAX-uDigit)/10 )
+          return ULLONG_MAX;
+        ull = ull*10+uDigit;
+      }
+      return ull;
+    }
+    /// @brief Writes the text of an unsigned integer and returns its size.
+    static size_t format( char* pch, unsigned long long ull )
+    {
+      static const char achDigits[] =
+        "0001020304050607080910111213141516171819"
+        "2021222324252627282930313233343536373839"
+        "4041424344454647484950515253545556575859"
+        "6061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+      char ach[20];
+      char* p = ach+sizeof(ach);
+      // two digits at once
+      for( ; ull >= 100; ull /= 100 )
+      {
+        p -= 2;
+        memcpy(p,achDigits+(ull%100)*2,2);
+      }
+      if( ull >= 10 )
+      {
+        p -= 2;
+        memcpy(p,achDigits+ull*2,2);
+      }
+      else
+        *--p = (char)('0'+ull);
+      const size_t unSize = ach+sizeof(ach)-p;
+      memcpy(pch,p,unSize);
+      return unSize;
+    }
+    /// @brief Writes the text of a typed value like std::ostream does and
+    ///        returns its size.
+    static size_t format( char* pch, EValueType eType, const Value& value )
+    {
+      switch( eType )
+      {
+      case INT_VALUE:
+        if( value.ll < 0 )
+        {
+          *pch = '-';
+          return 1+format(pch+1,0ULL-(unsigned long long)value.ll);
+        }
+        return format(pch,(unsigned long long)value.ll);
+      case UINT_VALUE:
+        return format(pch,value.ull);
+      case BOOL_VALUE:
+        *pch = value.b ? '1' : '0';
+        return 1;
+      case FLOAT_VALUE:
+        // integral values that %g writes without exponent
+        if( value.d > -1e6 && value.d < 1e6 && value.d == (double)(long long)value.d && (0 != value.d || !std::signbit(value.d)) )
+        {
+          Value v;
+          v.ll = (long long)value.d;
+          return format(pch,INT_VALUE,v);
+        }
+        {
+          // like %g in the C locale
+          std::ostringstream ss;
+          ss.imbue(std::locale::classic());
+          ss << value.d;
+          const std::string str = ss.str();
+          BOOST_ASSERT( str.size() <= FORMAT_SIZE );
+          memcpy(pch,str.data(),str.size());
+          return str.size();
+        }
+      default:
+        BOOST_ASSERT(0);
+        return 0;
+      }
+    }
+    /// @brief Positions of the children with one name.
+    struct Positions
+    {
+      explicit Positions( DomArena* pArena ) : m_vecPositions(DomAllocator<size_t>(pArena)), m_unHint(0) {}
+      std::vector<size_t,DomAllocator<size_t> > m_vecPositions;
+      /// @brief Entry of the last result, usually the next search starts
+      ///        behind it.
+      size_t              m_unHint;
+    };
+    /// @brief Index of the children by DomSymbol::id().
+    struct Index
+    {
+      typedef std::unordered_map<unsigned int,Positions,std::hash<unsigned int>,std::equal_to<unsigned int>,
+                                 DomAllocator<std::pair<const unsigned int,Positions> > > Map;
+      explicit Index( DomArena* pArena )
+        : m_map(0,Map::hasher(),Map::key_equal(),Map::allocator_type(pArena)), m_pArena(pArena), m_unSize(0) {}
+      Map         m_map;
+      DomArena*   m_pArena;
+      /// @brief Number of indexed children.
+      size_t      m_unSize;
+    };
+    /** @brief Returns the positions of the children with a name.
+     *  @details
+     *  The index is built on the first call and extended by children that
+     *  have been appended since the last call.
+     *  @return NULL if this node has too few children for an index.
+     */
+    Positions* index( DomSymbol symbol )
+    {
+      if( size() < INDEX_THRESHOLD )
+        return NULL;
+      // children have been removed behind our back
+      if( NULL != m_pIndex && m_pIndex->m_unSize > size() )
+        dropIndex();
+      if( NULL == m_pIndex )
+        m_pIndex = NULL != m_pArena ? new (m_pArena->allocate(sizeof(Index))) Index(m_pArena) : new Index(NULL);
+      for( size_t i=m_pIndex->m_unSize; i<size(); i++ )
+        m_pIndex->m_map.insert(Index::Map::value_type((*this)[i]->m_symbol.id(),Positions(m_pArena)))
+          .first->second.m_vecPositions.push_back(i);
+      m_pIndex->m_unSize = size();
+      static Positions none(NULL);
+      Index::Map::iterator it = m_pIndex->m_map.find(symbol.id());
+      return it != m_pIndex->m_map.end() ? &it->second : &none;
+    }
+    /// @brief find() with the positions from the index.
+    iterator find( Positions& positions, iterator& it )
+    {
+      const std::vector<size_t,DomAllocator<size_t> >& vec = positions.m_vecPositions;
+      size_t k=0;
+      // check if this is an initial call
+      if( it != begin() )
+      {
+        const size_t unPos = it-begin();
+        // usually the search starts at the entry behind the last result
+        k = positions.m_unHint;
+        if( k >= vec.size() || vec[k] < unPos || (k > 0 && vec[k-1] >= unPos) )
+          k = std::lower_bound(vec.begin(),vec.end(),unPos)-vec.begin();
+        // mixed iterator with different names or no more such items
+        BOOST_ASSERT( k < vec.size() );
+      }
+      if( k >= vec.size() )
+      {
+        it = end();
+        return end();
+      }
+      positions.m_unHint = k+1;
+      // set iterator 'it' to the position before the next occurrence
+      it = begin() + (k+1 < vec.size() ? vec[k+1]-1 : size()-1);
+      return begin() + vec[k];
+    }
     EDomCommandCode         m_eCommandCode;
     DomCommandFlags         m_nDomCommandFlags;
     /// @brief Pointer to parent node or NULL at root.
     DomNode*                m_pParent;
+    /// @brief Arena this node and its children are allocated in or NULL.
+    DomArena*               m_pArena;
+    /// @brief True if this node releases m_pArena.
+    bool                    m_bArenaOwner;
     /// @brief Name of this node.
-    std::string             m_strName;
-    std::string             m_strValue;
+    DomSymbol               m_symbol;
+    /// @brief Type of m_value or STRING_VALUE for m_strValue.
+    EValueType              m_eValueType;
+    Value                   m_value;
+    DomString               m_strValue;
     const char*             m_pchBinaryData;
     size_t                  m_unBinaryDataSize;
     void*                   m_pData;
-    std::string             m_strIndex;
+    DomString               m_strIndex;
+    /// @brief Index of the children or NULL (see index()).
+    Index*                  m_pIndex;
   };
 
   /** @defgroup DomStreamCommands DOM Stream Commands
@@ -461,16 +905,24 @@ namespace tbd
     DomNode::iterator*  m_pit;
   };
 
-  inline DomNode::DomNode(const DomCommand& command) :
+  inline DomNode::DomNode(const DomCommand& command, DomArena* pArena) :
+    base(DomAllocator<DomNode*>(pArena)),
     m_eCommandCode(command),
     m_nDomCommandFlags(command.flags()),
     m_pParent(NULL),
-    m_strName(command.name()?command.name():std::string()),
+    m_pArena(pArena),
+    m_bArenaOwner(false),
+    m_eValueType(NO_VALUE),
+    m_strValue(DomAllocator<char>(pArena)),
     m_pchBinaryData(NULL),
     m_unBinaryDataSize(0),
     m_pData(command.data()),
-    m_strIndex(command.index())
-  { }
+    m_strIndex(command.index().data(),command.index().size(),DomAllocator<char>(pArena)),
+    m_pIndex(NULL)
+  {
+    if( NULL != command.name() )
+      setName(command.name());
+  }
 
   namespace commands
   {
@@ -701,6 +1153,25 @@ namespace tbd
      *  @return A pointer to the root node
      */
     DomNode* getRoot() const { return m_pRoot; }
+    /// @brief Returns true if the nodes are created in an arena.
+    bool arena() const { return NULL != m_pRoot->arena(); }
+    /** @brief Enable or disable the arena mode.
+     *  @details
+     *  In arena mode nodes, children arrays, values and payloads are
+     *  allocated in a DomArena and the names are interned in its own table.
+     *  The arena belongs to the root node and the whole document is released
+     *  at once with it (also after detach()).
+     *  @attention Only possible as long as the document is empty.
+     *  @param bArena true to enable
+     *  @return the previous setting
+     */
+    bool arena( bool bArena )
+    {
+      const bool b = arena();
+      if( b != bArena )
+        m_pRoot->adopt(bArena ? new DomArena : NULL);
+      return b;
+    }
     /// @brief Check if the current node has a child with the given name
     bool exists(const char* pszName)
     { return getCurrent()->find(pszName) != getCurrent()->end(); }
@@ -815,6 +1286,34 @@ namespace tbd
    *  produce the protocol you like. For example have a look at XmlOStream and
    *  BinOStream
    */
+  /** @brief Receives the nodes of a DomOStream in streaming mode (see
+   *         DomOStream::stream()).
+   *  @ingroup DomStreams
+   */
+  class DomWriter
+  {
+  public:
+    virtual ~DomWriter() {}
+    /** @brief Writes the beginning of a node that gets its first child
+     *         element.
+     *  @details
+     *  The node has its attributes only, the children elements follow as
+     *  separate nodes.
+     *  @param pNode The node.
+     *  @param nDeepness Deepness of the node below the root node.
+     */
+    virtual void begin( DomNode* pNode, int nDeepness ) = 0;
+    /** @brief Writes a node that has been closed.
+     *  @param pNode The node.
+     *  @param nDeepness Deepness of the node below the root node.
+     *  @param bBegun true if begin() has been called for the node, so only
+     *         its end is missing.
+     */
+    virtual void end( DomNode* pNode, int nDeepness, bool bBegun ) = 0;
+    /// @brief Writes what has been buffered.
+    virtual void flush() {}
+  };
+
   class DomOStream
     : public DomStream
   {
@@ -823,7 +1322,7 @@ namespace tbd
      *  @param pRoot Node instance that will be used as root node and to create
      *         all sub nodes via pRoot->createNode().
      */
-    DomOStream(DomNode* pRoot=new DomNode(ROOT)) : DomStream(pRoot), m_bData(true), m_bShowMissing(false) {}
+    DomOStream(DomNode* pRoot=new DomNode(ROOT)) : DomStream(pRoot), m_bData(true), m_bShowMissing(false), m_pWriter(NULL) {}
     /** @brief Stream operator that receives a DOM command,
      *  @param cCommand command to inject into the stream.
      *  @return This instance as reference
@@ -889,6 +1388,38 @@ namespace tbd
     bool data(bool bData) { bool b=m_bData; m_bData = bData; return b; }
     bool showMissing() const { return m_bShowMissing; }
     bool showMissing(bool bShowMissing) { bool b=m_bShowMissing; m_bShowMissing = bShowMissing; return b; }
+    /** @brief Switches the streaming mode on or off.
+     *  @details
+     *  In streaming mode every node is handed to the writer as soon as it is
+     *  closed and removed from the DOM then. A node that gets children
+     *  elements is begun before the first one. So only the open nodes stay
+     *  in memory instead of the whole document.
+     *  @attention domreopen() isn't possible in streaming mode. Attributes
+     *             have to be added before the children elements.
+     *  @attention Streaming isn't possible in arena mode (see
+     *             DomStream::arena()): the arena would keep the memory of all
+     *             removed nodes until the document is destroyed.
+     *  @param pWriter Writer that receives the nodes (it isn't deleted) or
+     *         NULL to switch the streaming mode off.
+     */
+    void stream( DomWriter* pWriter )
+    {
+      BOOST_ASSERT( NULL == pWriter || !arena() );
+      if( NULL != m_pWriter )
+        m_pWriter->flush();
+      m_pWriter = pWriter;
+      m_vecBegun.clear();
+    }
+    /// @brief Returns the writer of the streaming mode or NULL.
+    DomWriter* stream() const { return m_pWriter; }
+    using DomStream::arena;
+    /// @brief Enable or disable the arena mode (see DomStream::arena(),
+    ///        not possible in streaming mode).
+    bool arena( bool bArena )
+    {
+      BOOST_ASSERT( !bArena || NULL == m_pWriter );
+      return DomStream::arena(bArena);
+    }
   protected:
     /** @brief Creates a new node and opens it.
      *  @details
@@ -901,6 +1432,9 @@ namespace tbd
       TBD_LOG_DOMSTREAM_OPERATIONS("tbd::DomOStream::newNode(): new node '" << getCurrent()->getPath() << "' + '" << cCommand.name() << "'" );
       // only OPEN, ATTRIBUTE or HIDDEN command should get here
       BOOST_ASSERT( OPEN == cCommand || ATTRIBUTE == cCommand );
+      // the streamed parent is begun before its first element
+      if( NULL != m_pWriter && OPEN == cCommand )
+        begin(getCurrent());
       // create a new node with the custom factory
       DomNode *pNode = getRoot()->createNode(cCommand);
       // append the new node to this' children
@@ -915,6 +1449,19 @@ namespace tbd
       if( getState() == CANCEL )
       {
         DomNode* closed=getCurrent();
+        // streamed children can't be canceled
+        BOOST_ASSERT( m_vecBegun.empty() || m_vecBegun.back() != closed );
+        DomStream::closeNode();
+        getCurrent()->erase(closed);
+      }
+      else if( NULL != m_pWriter && !getCurrent()->isAttribute() )
+      {
+        // hand the node to the writer and forget it
+        DomNode* closed=getCurrent();
+        const bool bBegun = !m_vecBegun.empty() && m_vecBegun.back() == closed;
+        if( bBegun )
+          m_vecBegun.pop_back();
+        m_pWriter->end(closed,deepness(closed),bBegun);
         DomStream::closeNode();
         getCurrent()->erase(closed);
       }
@@ -923,6 +1470,8 @@ namespace tbd
     }
     void reopenNode()
     {
+      // the last child has been streamed already
+      BOOST_ASSERT( NULL == m_pWriter );
       // check if current node isn't empty
       if( !getCurrent()->empty() )
       {
@@ -952,9 +1501,29 @@ namespace tbd
       }
     }
   private:
+    /// @brief Begins a node in streaming mode (if it isn't begun yet).
+    void begin( DomNode* pNode )
+    {
+      if( pNode == getRoot() || (!m_vecBegun.empty() && m_vecBegun.back() == pNode) )
+        return;
+      m_pWriter->begin(pNode,deepness(pNode));
+      m_vecBegun.push_back(pNode);
+    }
+    /// @brief Returns the deepness of a node below the root node.
+    static int deepness( const DomNode* pNode )
+    {
+      int n=0;
+      for( const DomNode* p=pNode->getParent(); NULL != p && NULL != p->getParent(); p=p->getParent() )
+        n++;
+      return n;
+    }
     /// store user data
     bool m_bData;
     bool m_bShowMissing;
+    /// @brief Writer of the streaming mode or NULL.
+    DomWriter*            m_pWriter;
+    /// @brief Open nodes that have been begun in streaming mode.
+    std::vector<DomNode*> m_vecBegun;
   };
   /** @brief This class is for deriving output streams.
    *  @ingroup DomStreamStreams
@@ -1021,16 +1590,17 @@ namespace tbd
       seq.clear();
       if (!missing())
       {
-        const std::string& name=getCurrent()->getName();
+        const DomSymbol symbol=getCurrent()->getSymbol();
         DomNode* parent = getCurrent()->getParent();
+        // find() skips the other children (with an index in large nodes)
         for( iterator it=parent->begin(); it!=parent->end(); it++ )
         {
-          if( (*it)->getName() == name )
-          {
-            setCurrent(*it);
-            seq.resize(seq.size()+1);
-            *this >> seq.back();
-          }
+          iterator itNode = parent->find(symbol,it);
+          if( itNode == parent->end() )
+            break;
+          setCurrent(*itNode);
+          seq.resize(seq.size()+1);
+          *this >> seq.back();
         }
       }
       return *this;
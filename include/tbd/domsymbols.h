@@ -0,0 +1,219 @@
+///////////////////////////////////////////////////////////////////////////////
+/// @file domsymbols.h
+/// @brief Interned names of DOM nodes
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TBD__DOMSYMBOLS_H
+#define __TBD__DOMSYMBOLS_H
+
+#include <boost/assert.hpp>
+#include <stddef.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tbd
+{
+  class DomSymbols;
+
+  /** @brief Interned name of a DOM node.
+   *  @details
+   *  Every distinct name is stored once in a DomSymbols table, so a symbol is
+   *  just a reference to it. Symbols of the same table compare like
+   *  integers, id() is a compact number of the name in its table. The
+   *  default symbol is the empty name and belongs to every table.
+   *  @ingroup DomStreams
+   */
+  class DomSymbol
+  {
+    friend class DomSymbols;
+    struct Entry
+    {
+      std::string         m_strName;
+      unsigned int        m_unId;
+      size_t              m_unHash;
+      const DomSymbols*   m_pSymbols;
+    };
+  public:
+    /// @brief Constructs the symbol of the empty name.
+    DomSymbol() : m_pEntry(NULL) {}
+    /// @brief Returns the number of this symbol (0 for the empty name).
+    unsigned int id() const { return NULL != m_pEntry ? m_pEntry->m_unId : 0; }
+    /// @brief Returns the name.
+    const std::string& name() const
+    {
+      static const std::string strEmpty;
+      return NULL != m_pEntry ? m_pEntry->m_strName : strEmpty;
+    }
+    /// @brief Returns the table of this symbol (NULL for the empty name).
+    const DomSymbols* symbols() const { return NULL != m_pEntry ? m_pEntry->m_pSymbols : NULL; }
+    /// @brief Returns true if this is the empty name.
+    bool empty() const { return NULL == m_pEntry; }
+    bool operator==( const DomSymbol& other ) const { return m_pEntry == other.m_pEntry; }
+    bool operator!=( const DomSymbol& other ) const { return m_pEntry != other.m_pEntry; }
+    bool operator<( const DomSymbol& other ) const { return id() < other.id(); }
+  private:
+    explicit DomSymbol( const Entry* pEntry ) : m_pEntry(pEntry) {}
+    const Entry* m_pEntry;
+  };
+
+  /** @brief Table of the names of DOM nodes.
+   *  @details
+   *  Documents in a DomArena intern their names in the table of the arena,
+   *  so names that come from data are released with the document. All other
+   *  documents and BinIndex share the global() table, which keeps its names
+   *  until the process ends.
+   *  @n Names that are already interned are looked up without a lock in an
+   *  open addressing hash table. Only adding a name is synchronized, so
+   *  documents can be built in several threads without waiting for each
+   *  other once their vocabulary is known.
+   *  @ingroup DomStreams
+   */
+  class DomSymbols
+  {
+    typedef DomSymbol::Entry Entry;
+  public:
+    /// @brief Constructs an empty table.
+    DomSymbols() : m_pTable(NULL) {}
+    ~DomSymbols()
+    {
+      for( size_t i=0; i<m_vecTables.size(); i++ )
+        delete m_vecTables[i];
+    }
+    /// @brief Returns the table shared by all documents without an arena.
+    static DomSymbols& global()
+    {
+      static DomSymbols symbols;
+      return symbols;
+    }
+    /** @brief Returns the symbol of a name and adds it if it's new.
+     *  @param strName Name to intern.
+     */
+    DomSymbol intern( const std::string& strName )
+    {
+      if( strName.empty() )
+        return DomSymbol();
+      const size_t unHash = std::hash<std::string>()(strName);
+      if( const Entry* pEntry = lookup(strName,unHash) )
+        return DomSymbol(pEntry);
+      std::lock_guard<std::mutex> lock(m_mutex);
+      // another thread may have added it meanwhile
+      if( const Entry* pEntry = lookup(strName,unHash) )
+        return DomSymbol(pEntry);
+      const Entry entry = { strName, (unsigned int)m_deqEntries.size()+1, unHash, this };
+      m_deqEntries.push_back(entry);
+      add(&m_deqEntries.back());
+      return DomSymbol(&m_deqEntries.back());
+    }
+    /** @brief Returns the symbol of a name without adding it.
+     *  @param strName Name to look up.
+     *  @param rSymbol Gets the symbol.
+     *  @return false if the name isn't known (no node can have it).
+     */
+    bool find( const std::string& strName, DomSymbol& rSymbol ) const
+    {
+      rSymbol = DomSymbol();
+      if( strName.empty() )
+        return true;
+      const Entry* pEntry = lookup(strName,std::hash<std::string>()(strName));
+      if( NULL == pEntry )
+        return false;
+      rSymbol = DomSymbol(pEntry);
+      return true;
+    }
+    /// @brief Returns the symbol with an id() or the empty one if there is
+    ///        none.
+    DomSymbol symbol( unsigned int unId ) const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if( 0 == unId || unId > m_deqEntries.size() )
+        return DomSymbol();
+      return DomSymbol(&m_deqEntries[unId-1]);
+    }
+    /// @brief Returns the number of names.
+    size_t size() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_deqEntries.size();
+    }
+  private:
+    enum
+    {
+      /// @brief Number of slots of the first hash table.
+      INITIAL_SLOTS = 256
+    };
+    /// @brief Open addressing hash table of the entries (at most half
+    ///        full).
+    struct Table
+    {
+      explicit Table( size_t unSlots ) : m_unMask(unSlots-1), m_apSlots(new std::atomic<const Entry*>[unSlots])
+      {
+        for( size_t i=0; i<unSlots; i++ )
+          m_apSlots[i].store(NULL,std::memory_order_relaxed);
+      }
+      ~Table() { delete[] m_apSlots; }
+      size_t                          m_unMask;
+      std::atomic<const Entry*>*      m_apSlots;
+    };
+    DomSymbols( const DomSymbols& );
+    DomSymbols& operator=( const DomSymbols& );
+    /// @brief Finds an entry without locking.
+    const Entry* lookup( const std::string& strName, size_t unHash ) const
+    {
+      const Table* pTable = m_pTable.load(std::memory_order_acquire);
+      if( NULL == pTable )
+        return NULL;
+      for( size_t i=unHash; ; i++ )
+      {
+        const Entry* pEntry = pTable->m_apSlots[i & pTable->m_unMask].load(std::memory_order_acquire);
+        if( NULL == pEntry )
+          return NULL;
+        if( pEntry->m_unHash == unHash && pEntry->m_strName == strName )
+          return pEntry;
+      }
+    }
+    /// @brief Adds a new entry to the hash table (m_mutex is locked).
+    void add( const Entry* pEntry )
+    {
+      Table* pTable = m_pTable.load(std::memory_order_relaxed);
+      if( NULL != pTable && 2*m_deqEntries.size() <= pTable->m_unMask+1 )
+      {
+        place(pTable,pEntry);
+        return;
+      }
+      // a larger table with all entries replaces the current one, readers
+      // may still use the old one, so it's kept until the destructor
+      pTable = new Table(NULL == pTable ? (size_t)INITIAL_SLOTS : 2*(pTable->m_unMask+1));
+      for( size_t i=0; i<m_deqEntries.size(); i++ )
+        place(pTable,&m_deqEntries[i]);
+      m_vecTables.push_back(pTable);
+      m_pTable.store(pTable,std::memory_order_release);
+    }
+    /// @brief Puts an entry into the first free slot behind its hash.
+    static void place( Table* pTable, const Entry* pEntry )
+    {
+      for( size_t i=pEntry->m_unHash; ; i++ )
+      {
+        std::atomic<const Entry*>& slot = pTable->m_apSlots[i & pTable->m_unMask];
+        if( NULL == slot.load(std::memory_order_relaxed) )
+        {
+          slot.store(pEntry,std::memory_order_release);
+          return;
+        }
+      }
+    }
+    /// @brief Synchronizes adding names.
+    mutable std::mutex            m_mutex;
+    /// @brief Current hash table.
+    std::atomic<Table*>           m_pTable;
+    /// @brief All hash tables that have been current.
+    std::vector<Table*>           m_vecTables;
+    /// @brief Entries by id (push_back() keeps the references valid).
+    std::deque<Entry>             m_deqEntries;
+  };
+}
+
+#endif
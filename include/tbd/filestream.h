@@ -13,8 +13,17 @@
 
 #include <errno.h>
 #include <assert.h>
+#include <string.h>
+#include <time.h>
+#include <sstream>
+#include <algorithm>
 
 #if defined(_WIN32) || defined(_WIN64)
+// keep std::min and std::max usable
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <windows.h>
 # include <io.h>
 # include <sys/stat.h>
 # include <fcntl.h>
@@ -25,8 +34,13 @@
 # include <unistd.h>
 # include <sys/types.h>
 # include <sys/stat.h>
+# include <sys/uio.h>
+# include <limits.h>
 # include <stdint.h>
 #endif
+#if defined(__linux__)
+# include <sys/sendfile.h>
+#endif
 
 /// @defgroup FileStreams File Streams
 /// @brief Streaming classes for handling (large) files
@@ -77,11 +91,54 @@ namespace tbd
     {
       ok, failed
     };
+    /// @brief When written data is committed to the disk.
+    enum Durability
+    {
+      /// @brief fsync() on every flush()
+      DM_FSYNC,
+      /// @brief never, leave it to the operating system
+      DM_NONE,
+      /// @brief fdatasync() on every flush() (doesn't sync metadata like
+      ///        the modification time)
+      DM_FDATASYNC,
+      /// @brief fdatasync() when a number of bytes has been written or an
+      ///        interval has passed since the last commit (group commit)
+      DM_PERIODIC,
+      /// @brief fsync() on close() only
+      DM_ON_CLOSE
+    };
   protected:
     /// @brief Constructor
-    FileStreamBase() : m_hFile(-1), m_eState(ok), m_eOpenMode(OM_CLOSED) {}
+    FileStreamBase() : m_hFile(-1), m_eState(ok), m_nGCount(0), m_eOpenMode(OM_CLOSED),
+      m_pchBuffer(NULL), m_unBufferSize(0), m_unBufferPos(0), m_unBufferFill(0),
+      m_bBufferDirty(false), m_nFilePos(0), m_eDurability(DM_FSYNC),
+      m_unCommitBytes(0), m_unCommitIntervalMs(0), m_unUncommitted(0), m_unLastCommitMs(0),
+      m_bPositional(false), m_nSysPos(0) {}
+    /// @brief Copy constructor
+    /// @details The copy shares the file handle but gets its own (empty)
+    /// buffer of the same size. Pending buffered data stays with the source.
+    FileStreamBase( const FileStreamBase& src ) : m_hFile(src.m_hFile), m_eState(src.m_eState),
+      m_nGCount(src.m_nGCount), m_eOpenMode(src.m_eOpenMode),
+#if defined( _WIN32 )
+      m_strFileName(src.m_strFileName),
+#endif
+      m_pchBuffer(NULL), m_unBufferSize(0), m_unBufferPos(0), m_unBufferFill(0),
+      m_bBufferDirty(false), m_nFilePos(src.m_nFilePos), m_eDurability(src.m_eDurability),
+      m_unCommitBytes(src.m_unCommitBytes), m_unCommitIntervalMs(src.m_unCommitIntervalMs),
+      m_unUncommitted(0), m_unLastCommitMs(src.m_unLastCommitMs),
+      m_bPositional(src.m_bPositional), m_nSysPos(src.tell())
+    {
+      // positional copies start at the logical position of the source
+      if( m_bPositional )
+        m_nFilePos = m_nSysPos;
+      if( src.m_unBufferSize > 0 )
+      {
+        m_unBufferSize = src.m_unBufferSize;
+        m_pchBuffer = new char[m_unBufferSize];
+      }
+    }
     /// @brief Destructor
-    virtual ~FileStreamBase() { close(); }
+    virtual ~FileStreamBase() { close(); delete[] m_pchBuffer; }
     void open( const std::string& rcFilename, OpenMode eOpenMode, int iPermMode=0777 )
     {
       m_eOpenMode = eOpenMode;
@@ -104,11 +161,26 @@ namespace tbd
 #else
       m_hFile = open( rcFilename.c_str(), eOpenMode, iPermMode );
 #endif
+      // appending writes can't be positional
+      if( OM_APPEND == eOpenMode )
+        m_bPositional = false;
+      m_nSysPos = 0;
+      // buffered streams track the file position by themselves
+      if( is_open() && NULL != m_pchBuffer )
+        m_nFilePos = sysseek(0,ORG_CUR);
+      m_unUncommitted = 0;
+      m_unLastCommitMs = now();
     }
     void close()
     {
       if( is_open() )
       {
+        // write what's left in the buffer
+        if( NULL != m_pchBuffer )
+          syncBuffer();
+        // commit what hasn't been committed yet
+        if( (DM_ON_CLOSE == m_eDurability || DM_PERIODIC == m_eDurability) && 0 < m_unUncommitted )
+          commit();
         /// @neverdoc
 #if defined( _WIN32 )
       ::_close( m_hFile );
@@ -121,6 +193,175 @@ namespace tbd
       }
     }
     bool is_open() const { return m_hFile >= 0; }
+    /** @brief Switch between buffered and unbuffered mode.
+     *  @details
+     *  In buffered mode small reads and writes are collected in a user space
+     *  buffer of the given size and handed to the system in large blocks.
+     *  Reads or writes that are larger than the buffer bypass it. The buffer
+     *  is written on seek, flush() and close().
+     *  @param unSize Size of the buffer in bytes or 0 for unbuffered mode.
+     */
+    void setBufferSize( size_t unSize )
+    {
+      // write pending data and restore the file position
+      if( NULL != m_pchBuffer )
+        syncBuffer();
+      delete[] m_pchBuffer;
+      m_pchBuffer = NULL;
+      m_unBufferSize = unSize;
+      m_unBufferPos = m_unBufferFill = 0;
+      m_bBufferDirty = false;
+      if( 0 < m_unBufferSize )
+      {
+        m_pchBuffer = new char[m_unBufferSize];
+        if( is_open() )
+          m_nFilePos = sysseek(0,ORG_CUR);
+      }
+    }
+    /// @brief Returns the buffer size or 0 if the stream is unbuffered.
+    size_t getBufferSize() const { return m_unBufferSize; }
+    /** @brief Switch between positional and sequential mode.
+     *  @details
+     *  In positional mode the stream keeps its file position by itself and
+     *  uses pread() and pwrite() instead of read(), write() and lseek(). So
+     *  tell() needs no system call and the file position of the system file
+     *  handle is never touched, which allows independent readers on the same
+     *  handle (see FileCursor).
+     *  @attention Not available on Windows and for appending streams.
+     *  @param bPositional true to enable positional mode.
+     *  @return true if the mode could be set.
+     */
+    bool setPositional( bool bPositional )
+    {
+#if defined( _WIN32 )
+      if( bPositional )
+        return false;
+#else
+      if( bPositional == m_bPositional )
+        return true;
+      if( bPositional && OM_APPEND == m_eOpenMode )
+        return false;
+      if( is_open() )
+      {
+        // take the file position over from or give it back to the system
+        if( bPositional )
+          m_nSysPos = sysseek(0,ORG_CUR);
+        else
+        {
+          streampos nPos = m_nSysPos;
+          m_bPositional = false;
+          sysseek(nPos,ORG_BEG);
+        }
+      }
+      m_bPositional = bPositional;
+#endif
+      return true;
+    }
+    /// @brief Returns true if the stream is in positional mode.
+    bool isPositional() const { return m_bPositional; }
+    /** @brief Copies size bytes from the read position of src to the write
+     *         position of dst inside the kernel.
+     *  @details
+     *  Uses copy_file_range() or sendfile() on Linux. Buffered data of both
+     *  streams is synchronized first. Both positions move behind the copied
+     *  data.
+     *  @return Number of bytes copied. 0 if the system can't copy between
+     *          these files, so the caller has to copy by itself.
+     */
+    static streampos nativecopy( FileStreamBase& dst, FileStreamBase& src, streampos size )
+    {
+      streampos copied = 0;
+#if defined(__linux__)
+      if( !dst.is_open() || !src.is_open() || OM_APPEND == dst.m_eOpenMode || 0 >= size )
+        return 0;
+      if( NULL != src.m_pchBuffer && !src.syncBuffer() )
+        return 0;
+      if( NULL != dst.m_pchBuffer && !dst.syncBuffer() )
+        return 0;
+      loff_t nIn = src.tell();
+      loff_t nOut = dst.tell();
+      // copy in large chunks
+      const size_t unChunk = 1 << 30;
+# if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+      while( copied < size )
+      {
+        ssize_t nRet = ::copy_file_range( src.m_hFile, &nIn, dst.m_hFile, &nOut, (size_t)std::min(size-copied,(streampos)unChunk), 0 );
+        if( 0 >= nRet )
+          break;
+        copied += nRet;
+      }
+# endif
+      // sendfile() writes at the file position of the system file handle
+      if( 0 == copied && !dst.m_bPositional )
+      {
+# if defined(__USE_LARGEFILE64)
+        off64_t nSendIn = (off64_t)nIn;
+# else
+        off_t nSendIn = (off_t)nIn;
+# endif
+        while( copied < size )
+        {
+# if defined(__USE_LARGEFILE64)
+          ssize_t nRet = ::sendfile64( dst.m_hFile, src.m_hFile, &nSendIn, (size_t)std::min(size-copied,(streampos)unChunk) );
+# else
+          ssize_t nRet = ::sendfile( dst.m_hFile, src.m_hFile, &nSendIn, (size_t)std::min(size-copied,(streampos)unChunk) );
+# endif
+          if( 0 >= nRet )
+            break;
+          copied += nRet;
+        }
+        nIn = nSendIn;
+        nOut += copied;
+      }
+      if( 0 < copied )
+      {
+        // move behind the copied data
+        src.m_nFilePos = src.sysseek( nIn, ORG_BEG );
+        dst.m_nFilePos = dst.sysseek( nOut, ORG_BEG );
+        dst.m_unUncommitted += copied;
+        dst.commitIfDue();
+      }
+#endif
+      return copied;
+    }
+    /** @brief Sets when written data is committed to the disk.
+     *  @details
+     *  By default (DM_FSYNC) every flush() calls fsync(). Writers that flush
+     *  often (like BitOStream) should use one of the other modes. DM_PERIODIC
+     *  bounds the data that can get lost to unBytes or unIntervalMs: it
+     *  commits on flush() or after writing to the file when either limit has
+     *  been reached.
+     *  @param eDurability Durability mode.
+     *  @param unBytes Bytes after which DM_PERIODIC commits (0 = no limit).
+     *  @param unIntervalMs Milliseconds after which DM_PERIODIC commits
+     *         (0 = no limit).
+     */
+    void setDurability( Durability eDurability, size_t unBytes=0, unsigned int unIntervalMs=0 )
+    {
+      m_eDurability = eDurability;
+      m_unCommitBytes = unBytes;
+      m_unCommitIntervalMs = unIntervalMs;
+    }
+    Durability getDurability() const { return m_eDurability; }
+    /// @brief Commits all data that has been written to the file to the disk
+    ///        regardless of the durability mode.
+    void commit()
+    {
+      if( !is_open() )
+        return;
+#if defined( _WIN32 )
+      _commit(m_hFile);
+#elif defined(_POSIX_SYNCHRONIZED_IO) && _POSIX_SYNCHRONIZED_IO > 0
+      if( DM_FDATASYNC == m_eDurability || DM_PERIODIC == m_eDurability )
+        ::fdatasync(m_hFile);
+      else
+        ::fsync(m_hFile);
+#else
+      ::fsync(m_hFile);
+#endif
+      m_unUncommitted = 0;
+      m_unLastCommitMs = now();
+    }
     /** @brief Read exactly size from this stream to pch
      *  @param pch Pointer to a piece of memory of at least size bytes
      *  length.
@@ -138,16 +379,17 @@ namespace tbd
       }
       // init
       m_nGCount = 0;
+      if( NULL != m_pchBuffer )
+      {
+        readBuffered(pch,size);
+        return;
+      }
 
       while( 0 != size )
       {
         int nRet;
         // try to read from file
-#if defined( _WIN32 )
-        nRet = ::_read( m_hFile, (void*)(pch + m_nGCount), (unsigned int)size );
-#else
-        nRet = ::read( m_hFile, (void*)(pch + m_nGCount), size );
-#endif
+        nRet = sysread( pch + m_nGCount, size );
         // return if error occurred
         if( 0 > nRet )
         {
@@ -180,12 +422,13 @@ namespace tbd
       }
       if( 0==size )
         return;
+      if( NULL != m_pchBuffer )
+      {
+        writeBuffered(pch,size);
+        return;
+      }
       int nRet;
-#if defined( _WIN32 )
-      nRet = ::_write( m_hFile, (void*)pch, (unsigned int)size );
-#else
-      nRet = ::write( m_hFile, (void*)pch, size );
-#endif
+      nRet = syswrite( pch, size );
       // return if error occurred
       if( 0 > nRet )
       {
@@ -193,19 +436,71 @@ namespace tbd
         m_eState = failed;
         return;
       }
+      commitIfDue();
+    }
+    /** @brief Write count memory blocks into the file.
+     *  @details
+     *  Unbuffered streams write all blocks with as few writev() system calls
+     *  as possible. Buffered streams collect the blocks in the buffer if they
+     *  fit into it or write them directly after the buffer has been emptied.
+     *  @param iov Array of memory blocks to write.
+     *  @param count Number of blocks in iov.
+     */
+    void writev( const iovec* iov, size_t count )
+    {
+      // paranoia checks
+      if( !is_open() )
+      {
+        BOOST_ASSERT(0);
+        m_eState = failed;
+        return;
+      }
+      size_t size = 0;
+      for( size_t i=0; i<count; i++ )
+        size += iov[i].iov_len;
+      if( 0==size )
+        return;
+      if( NULL != m_pchBuffer )
+      {
+        // small batches are collected in the buffer
+        if( size < m_unBufferSize )
+        {
+          for( size_t i=0; i<count && ok==m_eState; i++ )
+            writeBuffered( (const char*)iov[i].iov_base, iov[i].iov_len );
+          return;
+        }
+        // write pending data or drop the read ahead
+        if( !syncBuffer() )
+          return;
+      }
+      syswritevall( iov, count );
     }
     /// @brief Flushes the stream to memory.
     void flush()
     {
-#if defined( _WIN32 )
-      _commit(m_hFile);
-#else
-      ::fsync(m_hFile);
-#endif
+      // write buffered data
+      if( NULL != m_pchBuffer )
+        syncBuffer();
+      switch( m_eDurability )
+      {
+      case DM_FSYNC:
+      case DM_FDATASYNC:
+        commit();
+        break;
+      case DM_PERIODIC:
+        commitIfDue();
+        break;
+      default:
+        break;
+      }
     }
     void unget()
     {
-      seek(-1,ORG_CUR);
+      // step back within the read buffer
+      if( NULL != m_pchBuffer && !m_bBufferDirty && m_unBufferPos > 0 )
+        m_unBufferPos--;
+      else
+        seek(-1,ORG_CUR);
     }
     int peek()
 	  {
@@ -213,13 +508,24 @@ namespace tbd
       // paranoia checks
       if( !is_open() )
         return -1;
+      if( NULL != m_pchBuffer )
+      {
+        // make sure there is something in the read buffer
+        if( m_bBufferDirty || m_unBufferPos == m_unBufferFill )
+        {
+          if( !syncBuffer() || !fillBuffer() )
+            return -1;
+          if( 0 == m_unBufferFill )
+          {
+            m_eState = (0 == m_nGCount)?failed:ok;
+            return -1;
+          }
+        }
+        return (unsigned char)m_pchBuffer[m_unBufferPos];
+      }
       int nRet;
       // try to read from file
-#if defined( _WIN32 )
-      nRet = ::_read( m_hFile, (void*)&ch, 1 );
-#else
-      nRet = ::read( m_hFile, (void*)&ch, 1 );
-#endif
+      nRet = sysread( &ch, 1 );
       // return if error occurred
       if( 0 > nRet )
         return -1;
@@ -230,13 +536,19 @@ namespace tbd
         return -1;
       }
       seek(-1,ORG_CUR);
-      return ch;
+      return (unsigned char)ch;
 	  }
     /// @brief Returns the current read position.
     streampos tell() const
     {
       if( !is_open() )
         return bit::bitmask<streampos>();
+      // buffered streams know their position
+      if( NULL != m_pchBuffer )
+        return m_bBufferDirty ? m_nFilePos + (streampos)m_unBufferFill : m_nFilePos - (streampos)(m_unBufferFill - m_unBufferPos);
+      // positional streams too
+      if( m_bPositional )
+        return m_nSysPos;
       streampos nG;
 #if defined( _WIN32 )
       nG = _telli64( m_hFile);
@@ -254,12 +566,13 @@ namespace tbd
         BOOST_ASSERT(0);
         return;
       }
+      if( NULL != m_pchBuffer )
+      {
+        seekBuffered(g,eOrigin);
+        return;
+      }
       streampos nNewG;
-#if defined( _WIN32 )
-      nNewG = _lseeki64( m_hFile, g, eOrigin );
-#else
-      nNewG = lseek64( m_hFile, g, eOrigin );
-#endif
+      nNewG = sysseek( g, eOrigin );
       m_eState = (nNewG<0)?failed:ok;
     }
     streampos gcount() const { return m_nGCount; }
@@ -317,6 +630,311 @@ namespace tbd
     }
 #endif
   private:
+    friend class FileCursor;
+    friend huge_streampos nativecopy( FileStreamBase* pos, FileStreamBase* pis, huge_streampos size );
+    int sysread( char* pch, size_t size )
+    {
+#if defined( _WIN32 )
+      return ::_read( m_hFile, (void*)pch, (unsigned int)size );
+#else
+      if( m_bPositional )
+      {
+        int nRet = syspread( m_hFile, pch, size, m_nSysPos );
+        if( 0 < nRet )
+          m_nSysPos += nRet;
+        return nRet;
+      }
+      return (int)::read( m_hFile, (void*)pch, size );
+#endif
+    }
+    int syswrite( const char* pch, size_t size )
+    {
+#if defined( _WIN32 )
+      int nRet = ::_write( m_hFile, (void*)pch, (unsigned int)size );
+#else
+      int nRet;
+      if( m_bPositional )
+      {
+# if defined(__USE_LARGEFILE64)
+        nRet = (int)::pwrite64( m_hFile, (const void*)pch, size, m_nSysPos );
+# else
+        nRet = (int)::pwrite( m_hFile, (const void*)pch, size, m_nSysPos );
+# endif
+        if( 0 < nRet )
+          m_nSysPos += nRet;
+      }
+      else
+        nRet = (int)::write( m_hFile, (void*)pch, size );
+#endif
+      if( 0 < nRet )
+        m_unUncommitted += nRet;
+      return nRet;
+    }
+#if !defined( _WIN32 )
+    /// @brief Reads from a file position without touching the system file
+    ///        position.
+    static int syspread( int hFile, char* pch, size_t size, const streampos& g )
+    {
+# if defined(__USE_LARGEFILE64)
+      return (int)::pread64( hFile, (void*)pch, size, g );
+# else
+      return (int)::pread( hFile, (void*)pch, size, g );
+# endif
+    }
+#endif
+    /// @brief Returns a monotonic time in milliseconds.
+    static unsigned long long now()
+    {
+#if defined( _WIN32 )
+      return ::GetTickCount64();
+#else
+      struct timespec ts;
+      ::clock_gettime( CLOCK_MONOTONIC, &ts );
+      return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+    }
+    /// @brief Commits in DM_PERIODIC mode if one of the limits is reached.
+    void commitIfDue()
+    {
+      if( DM_PERIODIC != m_eDurability || 0 == m_unUncommitted )
+        return;
+      if( ( 0 < m_unCommitBytes && m_unUncommitted >= m_unCommitBytes ) ||
+          ( 0 < m_unCommitIntervalMs && now() - m_unLastCommitMs >= m_unCommitIntervalMs ) )
+        commit();
+    }
+    streampos sysseek( const streampos& g, Origin eOrigin )
+    {
+#if defined( _WIN32 )
+      return _lseeki64( m_hFile, g, eOrigin );
+#else
+      if( m_bPositional )
+      {
+        streampos nNewG = g;
+        if( ORG_CUR == eOrigin )
+          nNewG += m_nSysPos;
+        else if( ORG_END == eOrigin )
+          nNewG += (streampos)stat().st_size;
+        if( nNewG < 0 )
+        {
+          errno = EINVAL;
+          return -1;
+        }
+        return m_nSysPos = nNewG;
+      }
+      return lseek64( m_hFile, g, eOrigin );
+#endif
+    }
+    /// @brief Writes size bytes completely and keeps track of the file position.
+    bool syswriteall( const char* pch, size_t size )
+    {
+      while( 0 != size )
+      {
+        int nRet = syswrite( pch, size );
+        if( 0 > nRet )
+        {
+          BOOST_ASSERT(0);
+          m_eState = failed;
+          return false;
+        }
+        pch += nRet;
+        size -= nRet;
+        m_nFilePos += nRet;
+      }
+      // appending writes always go to the end of file
+      if( OM_APPEND == m_eOpenMode )
+        m_nFilePos = sysseek(0,ORG_CUR);
+      commitIfDue();
+      return true;
+    }
+    /// @brief Writes count memory blocks completely and keeps track of the
+    ///        file position.
+    bool syswritevall( const iovec* iov, size_t count )
+    {
+#if defined( _WIN32 )
+      for( size_t i=0; i<count; i++ )
+        if( !syswriteall( (const char*)iov[i].iov_base, iov[i].iov_len ) )
+          return false;
+#else
+# if defined( IOV_MAX )
+      const size_t unMaxBlocks = IOV_MAX;
+# else
+      const size_t unMaxBlocks = 16;
+# endif
+      while( 0 != count )
+      {
+        ssize_t nRet;
+        if( m_bPositional )
+        {
+# if defined(__linux__) && defined(__USE_LARGEFILE64)
+          nRet = ::pwritev64( m_hFile, iov, (int)std::min(count,unMaxBlocks), m_nSysPos );
+# elif defined(__linux__)
+          nRet = ::pwritev( m_hFile, iov, (int)std::min(count,unMaxBlocks), m_nSysPos );
+# else
+          // no gathered positional writes
+          nRet = ::pwrite( m_hFile, iov->iov_base, iov->iov_len, m_nSysPos );
+# endif
+          if( 0 < nRet )
+            m_nSysPos += nRet;
+        }
+        else
+          nRet = ::writev( m_hFile, iov, (int)std::min(count,unMaxBlocks) );
+        if( 0 > nRet )
+        {
+          BOOST_ASSERT(0);
+          m_eState = failed;
+          return false;
+        }
+        m_nFilePos += nRet;
+        m_unUncommitted += nRet;
+        // skip all completely written blocks
+        while( 0 != count && (size_t)nRet >= iov->iov_len )
+        {
+          nRet -= iov->iov_len;
+          iov++;
+          count--;
+        }
+        // write the rest of a partially written block
+        if( 0 != nRet )
+        {
+          if( !syswriteall( (const char*)iov->iov_base + nRet, iov->iov_len - nRet ) )
+            return false;
+          iov++;
+          count--;
+        }
+      }
+      // appending writes always go to the end of file
+      if( OM_APPEND == m_eOpenMode )
+        m_nFilePos = sysseek(0,ORG_CUR);
+#endif
+      commitIfDue();
+      return true;
+    }
+    /// @brief Reads the next block from file into the empty buffer.
+    bool fillBuffer()
+    {
+      BOOST_ASSERT(!m_bBufferDirty && m_unBufferPos == m_unBufferFill);
+      int nRet = sysread( m_pchBuffer, m_unBufferSize );
+      m_unBufferPos = m_unBufferFill = 0;
+      if( 0 > nRet )
+      {
+        BOOST_ASSERT(0);
+        m_eState = failed;
+        return false;
+      }
+      m_unBufferFill = nRet;
+      m_nFilePos += nRet;
+      return true;
+    }
+    /** @brief Empties the buffer.
+     *  @details
+     *  Writes pending data or moves the file position back to the logical
+     *  read position if there are unread bytes in the buffer.
+     */
+    bool syncBuffer()
+    {
+      bool bOk = true;
+      if( m_bBufferDirty )
+        bOk = syswriteall( m_pchBuffer, m_unBufferFill );
+      else if( m_unBufferPos < m_unBufferFill )
+        m_nFilePos = sysseek( m_nFilePos - (streampos)(m_unBufferFill - m_unBufferPos), ORG_BEG );
+      m_unBufferPos = m_unBufferFill = 0;
+      m_bBufferDirty = false;
+      return bOk;
+    }
+    void readBuffered( char* pch, size_t size )
+    {
+      // switch from writing to reading
+      if( m_bBufferDirty && !syncBuffer() )
+        return;
+      while( 0 != size )
+      {
+        size_t unAvail = m_unBufferFill - m_unBufferPos;
+        if( 0 == unAvail )
+        {
+          // large reads go directly into the destination
+          if( size >= m_unBufferSize )
+          {
+            int nRet = sysread( pch + m_nGCount, size );
+            if( 0 > nRet )
+            {
+              BOOST_ASSERT(0);
+              m_eState = failed;
+              return;
+            }
+            else if( 0 == nRet )
+            {
+              m_eState = (0 == m_nGCount)?failed:ok;
+              return;
+            }
+            m_nFilePos += nRet;
+            size -= nRet;
+            m_nGCount += nRet;
+            continue;
+          }
+          if( !fillBuffer() )
+            return;
+          // check if we reached end of file
+          if( 0 == m_unBufferFill )
+          {
+            m_eState = (0 == m_nGCount)?failed:ok;
+            return;
+          }
+          unAvail = m_unBufferFill;
+        }
+        size_t unCopy = std::min(size,unAvail);
+        ::memcpy( pch + m_nGCount, m_pchBuffer + m_unBufferPos, unCopy );
+        m_unBufferPos += unCopy;
+        size -= unCopy;
+        m_nGCount += unCopy;
+      }
+    }
+    void writeBuffered( const char* pch, size_t size )
+    {
+      // drop read ahead when switching from reading to writing
+      if( !m_bBufferDirty && 0 < m_unBufferFill && !syncBuffer() )
+        return;
+      // make room in the buffer
+      if( m_unBufferFill + size > m_unBufferSize && !syncBuffer() )
+        return;
+      // large writes go directly into the file
+      if( size >= m_unBufferSize )
+      {
+        syswriteall( pch, size );
+        return;
+      }
+      ::memcpy( m_pchBuffer + m_unBufferFill, pch, size );
+      m_unBufferFill += size;
+      m_bBufferDirty = true;
+    }
+    void seekBuffered( const streampos& g, Origin eOrigin )
+    {
+      streampos nNewG;
+      if( ORG_END == eOrigin )
+      {
+        if( !syncBuffer() )
+          return;
+        nNewG = sysseek( g, eOrigin );
+      }
+      else
+      {
+        streampos nTarget = (ORG_CUR == eOrigin) ? tell() + g : g;
+        // positions within the read buffer need no system call
+        if( !m_bBufferDirty && nTarget >= m_nFilePos - (streampos)m_unBufferFill && nTarget <= m_nFilePos )
+        {
+          m_unBufferPos = (size_t)(nTarget - (m_nFilePos - (streampos)m_unBufferFill));
+          m_eState = ok;
+          return;
+        }
+        // write pending data and drop the read ahead
+        if( m_bBufferDirty && !syncBuffer() )
+          return;
+        m_unBufferPos = m_unBufferFill = 0;
+        nNewG = sysseek( nTarget, ORG_BEG );
+      }
+      if( nNewG >= 0 )
+        m_nFilePos = nNewG;
+      m_eState = (nNewG<0)?failed:ok;
+    }
     int         m_hFile;
     State       m_eState;
     streampos   m_nGCount;
@@ -324,6 +942,32 @@ namespace tbd
 #if defined( _WIN32 )
     std::string m_strFileName;
 #endif
+    /// @brief Buffer for buffered mode or NULL if unbuffered.
+    char*       m_pchBuffer;
+    /// @brief Size of m_pchBuffer.
+    size_t      m_unBufferSize;
+    /// @brief Read position within the buffer.
+    size_t      m_unBufferPos;
+    /// @brief Number of valid bytes in the buffer.
+    size_t      m_unBufferFill;
+    /// @brief True if the buffer contains data that has not been written yet.
+    bool        m_bBufferDirty;
+    /// @brief File position of the system file handle in buffered mode.
+    streampos   m_nFilePos;
+    Durability  m_eDurability;
+    /// @brief Bytes after which DM_PERIODIC commits.
+    size_t      m_unCommitBytes;
+    /// @brief Milliseconds after which DM_PERIODIC commits.
+    unsigned int m_unCommitIntervalMs;
+    /// @brief Bytes written to the file since the last commit.
+    size_t      m_unUncommitted;
+    /// @brief Time of the last commit (see now()).
+    unsigned long long m_unLastCommitMs;
+    /// @brief True in positional mode.
+    bool        m_bPositional;
+    /// @brief File position in positional mode (replaces the position of
+    ///        the system file handle).
+    streampos   m_nSysPos;
   };
   /// @ingroup FileStreams
   class FileIStream
@@ -341,7 +985,9 @@ namespace tbd
     /// @brief Constructor
     FileIStream() {}
     /// @brief Constructor opening a file
-    FileIStream( const std::string& rcFilename ) { open(rcFilename); }
+    /// @param rcFilename Name of the file to open.
+    /// @param unBufferSize Size of the read buffer or 0 for unbuffered reading.
+    FileIStream( const std::string& rcFilename, size_t unBufferSize=0 ) { setBufferSize(unBufferSize); open(rcFilename); }
     /// @brief Destructor
     ~FileIStream() {}
     void open( const std::string& rcFilename )
@@ -359,6 +1005,10 @@ namespace tbd
     virtual bool fail() const { return FileStreamBase::fail(); }
     virtual int peek() { return FileStreamBase::peek(); }
     virtual void unget() { return FileStreamBase::unget(); }
+    void setBufferSize( size_t unSize ) { FileStreamBase::setBufferSize(unSize); }
+    size_t getBufferSize() const { return FileStreamBase::getBufferSize(); }
+    bool setPositional( bool bPositional ) { return FileStreamBase::setPositional(bPositional); }
+    bool isPositional() const { return FileStreamBase::isPositional(); }
     OpenMode mode() const { return FileStreamBase::mode(); }
     bool canWrite() const { return false; }
     int err_no() const { return FileStreamBase::err_no(); }
@@ -383,8 +1033,12 @@ namespace tbd
     /// @brief Constructor
     FileOStream() { }
     /// @brief Constructor opening a file
-    FileOStream( const std::string& rcFilename, bool bAppend=false )
+    /// @param rcFilename Name of the file to open.
+    /// @param bAppend If true, output will be appended to an existing file.
+    /// @param unBufferSize Size of the write buffer or 0 for unbuffered writing.
+    FileOStream( const std::string& rcFilename, bool bAppend=false, size_t unBufferSize=0 )
     {
+      FileStreamBase::setBufferSize(unBufferSize);
       FileStreamBase::open(rcFilename,bAppend?OM_APPEND:OM_WRITEONLY,_S_IWRITE);
     }
     /// @brief Destructor
@@ -395,12 +1049,20 @@ namespace tbd
     }
     virtual bool is_open() const { return FileStreamBase::is_open(); }
     virtual void write( const char* pch, size_t size ) { FileStreamBase::write(pch,size); }
+    virtual void writev( const iovec* iov, size_t count ) { FileStreamBase::writev(iov,count); }
     /// @brief Returns the current read position.
     virtual streampos tellp() const { return FileStreamBase::tell(); }
     /// @brief Sets the current read position.
     virtual void seekp(const streampos& p) { FileStreamBase::seek(p,ORG_BEG); }
     virtual void seekp2end() { FileStreamBase::seek(0,ORG_END); }
     virtual void flush() { FileStreamBase::flush(); }
+    void setBufferSize( size_t unSize ) { FileStreamBase::setBufferSize(unSize); }
+    size_t getBufferSize() const { return FileStreamBase::getBufferSize(); }
+    bool setPositional( bool bPositional ) { return FileStreamBase::setPositional(bPositional); }
+    bool isPositional() const { return FileStreamBase::isPositional(); }
+    void setDurability( Durability eDurability, size_t unBytes=0, unsigned int unIntervalMs=0 ) { FileStreamBase::setDurability(eDurability,unBytes,unIntervalMs); }
+    Durability getDurability() const { return FileStreamBase::getDurability(); }
+    void commit() { FileStreamBase::commit(); }
     OpenMode mode() const { return FileStreamBase::mode(); }
     bool canWrite() const { return true; }
     int err_no() const { return FileStreamBase::err_no(); }
@@ -426,7 +1088,9 @@ namespace tbd
     FileStream() { }
     FileStream( const FileStream& src ) : FileStreamBase(src) { }
     /// @brief Constructor opening a file
-    FileStream( const std::string& rcFilename ) { open(rcFilename); }
+    /// @param rcFilename Name of the file to open.
+    /// @param unBufferSize Size of the read/write buffer or 0 for unbuffered I/O.
+    FileStream( const std::string& rcFilename, size_t unBufferSize=0 ) { setBufferSize(unBufferSize); open(rcFilename); }
     /// @brief Destructor
     void open( const std::string& rcFilename, OpenMode eOpenMode=OM_READWRITE, int iPermMode=_S_IWRITE|_S_IREAD )
     {
@@ -443,9 +1107,17 @@ namespace tbd
     virtual streampos gcount() const { return FileStreamBase::gcount(); }
     virtual bool fail() const { return FileStreamBase::fail(); }
     virtual void write( const char* pch, size_t size ) { FileStreamBase::write(pch,size); }
+    virtual void writev( const iovec* iov, size_t count ) { FileStreamBase::writev(iov,count); }
     virtual void flush() { FileStreamBase::flush(); }
     virtual int peek() { return FileStreamBase::peek(); }
     virtual void unget() { return FileStreamBase::unget(); }
+    void setBufferSize( size_t unSize ) { FileStreamBase::setBufferSize(unSize); }
+    size_t getBufferSize() const { return FileStreamBase::getBufferSize(); }
+    bool setPositional( bool bPositional ) { return FileStreamBase::setPositional(bPositional); }
+    bool isPositional() const { return FileStreamBase::isPositional(); }
+    void setDurability( Durability eDurability, size_t unBytes=0, unsigned int unIntervalMs=0 ) { FileStreamBase::setDurability(eDurability,unBytes,unIntervalMs); }
+    Durability getDurability() const { return FileStreamBase::getDurability(); }
+    void commit() { FileStreamBase::commit(); }
     OpenMode mode() const { return FileStreamBase::mode(); }
     bool canWrite() const { return FileStreamBase::canWrite(); }
     int err_no() const { return FileStreamBase::err_no(); }
@@ -463,5 +1135,196 @@ namespace tbd
     operator FileOStream&() { return *this; }
     operator FileIStream&() { return *this; }
   };
+  /** @brief Kernel side copy between file streams (see streamcopy()).
+   *  @ingroup FileStreams
+   */
+  __inline huge_streampos nativecopy( FileStreamBase* pos, FileStreamBase* pis, huge_streampos size )
+  {
+    return FileStreamBase::nativecopy(*pos,*pis,size);
+  }
+#if !defined( _WIN32 )
+  /** @brief Lightweight input stream that reads an open file with pread().
+   *  @details
+   *  A cursor has its own read position and reads without touching the
+   *  position of the file handle. So any number of cursors can read
+   *  independent regions of one file concurrently (one cursor per thread)
+   *  without locking or seeking. An optional read ahead buffer saves system
+   *  calls for small reads and lends its content (see IStream::borrow()).
+   *  @attention The file stream has to stay open as long as its cursors are
+   *             used. Data in the write buffer of the file stream isn't
+   *             visible to cursors before it has been flushed.
+   *  @ingroup FileStreams
+   */
+  class FileCursor
+    : public IStream<huge_streampos>
+  {
+    IMPLEMENT_ISTREAM_OPERATORS(FileCursor,huge_streampos);
+  public:
+    typedef huge_streampos streampos;
+    /** @brief Constructor
+     *  @param file Open file to read from.
+     *  @param g Read position to start at.
+     *  @param unBufferSize Size of the read ahead buffer or 0 for none.
+     */
+    FileCursor( const FileStreamBase& file, streampos g=0, size_t unBufferSize=0 )
+      : m_hFile(file.m_hFile), m_nG(g), m_nGCount(0), m_bFail(false)
+      , m_pchBuffer(unBufferSize>0 ? new char[unBufferSize] : NULL), m_unBufferSize(unBufferSize)
+      , m_nBufferPos(0), m_unBufferFill(0)
+    {}
+    /// @brief Copy constructor (the copy gets its own buffer)
+    FileCursor( const FileCursor& src )
+      : m_hFile(src.m_hFile), m_nG(src.m_nG), m_nGCount(0), m_bFail(src.m_bFail)
+      , m_pchBuffer(src.m_unBufferSize>0 ? new char[src.m_unBufferSize] : NULL), m_unBufferSize(src.m_unBufferSize)
+      , m_nBufferPos(0), m_unBufferFill(0)
+    {}
+    /// @brief Destructor
+    ~FileCursor() { delete[] m_pchBuffer; }
+    virtual bool is_open() const { return m_hFile >= 0; }
+    /** @brief Read up to size bytes from this stream to pch.
+     *  @param pch Pointer to a piece of memory of at least size bytes length.
+     *  @param size Maximum number of bytes to read.
+     */
+    virtual void read( char* pch, size_t size )
+    {
+      m_nGCount = 0;
+      while( 0 != size )
+      {
+        size_t unAvail;
+        const char* pchAvail = buffered(unAvail);
+        if( NULL != pchAvail )
+        {
+          size_t unCopy = std::min(size,unAvail);
+          ::memcpy(pch+m_nGCount,pchAvail,unCopy);
+          m_nG += unCopy;
+          m_nGCount += unCopy;
+          size -= unCopy;
+          continue;
+        }
+        int nRet;
+        // large reads go directly into the destination
+        if( size >= m_unBufferSize )
+        {
+          nRet = FileStreamBase::syspread( m_hFile, pch+m_nGCount, size, m_nG );
+          if( 0 < nRet )
+          {
+            m_nG += nRet;
+            m_nGCount += nRet;
+            size -= nRet;
+          }
+        }
+        else
+          nRet = fill();
+        if( 0 > nRet )
+        {
+          BOOST_ASSERT(0);
+          m_bFail = true;
+          return;
+        }
+        // end of file
+        if( 0 == nRet )
+          break;
+      }
+      m_bFail = 0 == m_nGCount;
+    }
+    virtual const char* borrow( size_t size )
+    {
+      size_t unAvail;
+      const char* p = buffered(unAvail);
+      if( NULL == p || unAvail < size )
+        return NULL;
+      m_nG += size;
+      m_nGCount = size;
+      m_bFail = false;
+      return p;
+    }
+    virtual const char* window( size_t& size ) const
+    {
+      const char* p = buffered(size);
+      if( NULL == p )
+        size = 0;
+      return p;
+    }
+    virtual int peek()
+    {
+      size_t unAvail;
+      const char* p = buffered(unAvail);
+      if( NULL == p && NULL != m_pchBuffer && 0 < fill() )
+        p = buffered(unAvail);
+      if( NULL != p )
+      {
+        m_bFail = false;
+        return (unsigned char)*p;
+      }
+      char ch;
+      if( NULL == m_pchBuffer && 1 == FileStreamBase::syspread( m_hFile, &ch, 1, m_nG ) )
+      {
+        m_bFail = false;
+        return (unsigned char)ch;
+      }
+      m_bFail = true;
+      return -1;
+    }
+    virtual void unget()
+    {
+      if( m_nG > 0 )
+        m_nG--;
+      else
+        m_bFail = true;
+    }
+    /// @brief Returns the current read position.
+    virtual streampos tellg() const { return m_nG; }
+    /// @brief Sets the current read position.
+    virtual void seekg( const streampos& g )
+    {
+      m_bFail = g < 0;
+      if( !m_bFail )
+        m_nG = g;
+    }
+    virtual void seekg2end()
+    {
+# if defined(__USE_LARGEFILE64)
+      struct stat64 filestat;
+      m_bFail = 0 != fstat64(m_hFile,&filestat);
+# else
+      struct stat filestat;
+      m_bFail = 0 != fstat(m_hFile,&filestat);
+# endif
+      if( !m_bFail )
+        m_nG = filestat.st_size;
+    }
+    virtual streampos gcount() const { return m_nGCount; }
+    virtual bool fail() const { return m_bFail; }
+  private:
+    FileCursor& operator=( const FileCursor& );
+    /// @brief Returns the buffered bytes at the read position or NULL.
+    const char* buffered( size_t& unAvail ) const
+    {
+      if( m_nG < m_nBufferPos || m_nG >= m_nBufferPos + (streampos)m_unBufferFill )
+        return NULL;
+      unAvail = m_unBufferFill - (size_t)(m_nG - m_nBufferPos);
+      return m_pchBuffer + (m_nG - m_nBufferPos);
+    }
+    /// @brief Fills the buffer from the read position on.
+    int fill()
+    {
+      int nRet = FileStreamBase::syspread( m_hFile, m_pchBuffer, m_unBufferSize, m_nG );
+      m_nBufferPos = m_nG;
+      m_unBufferFill = 0 < nRet ? nRet : 0;
+      return nRet;
+    }
+    int         m_hFile;
+    /// @brief Read position.
+    streampos   m_nG;
+    streampos   m_nGCount;
+    bool        m_bFail;
+    /// @brief Read ahead buffer or NULL.
+    char*       m_pchBuffer;
+    size_t      m_unBufferSize;
+    /// @brief File position of the first byte in the buffer.
+    streampos   m_nBufferPos;
+    /// @brief Number of valid bytes in the buffer.
+    size_t      m_unBufferFill;
+  };
+#endif
 }
 #endif
@@ -0,0 +1,360 @@
+///////////////////////////////////////////////////////////////////////////////
+/// @file huffman.h
+/// @brief Canonical Huffman code for bit streams
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TBD__HUFFMAN_H
+#define __TBD__HUFFMAN_H
+
+#include "bit.h"
+#include "bitstream.h"
+#include "bitcodec.h"
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+
+namespace tbd
+{
+  /** @brief Canonical Huffman code over the symbols 0..symbols()-1.
+   *  @details
+   *  The code is built from symbol frequencies (build()) or read from a bit
+   *  stream (read()). Only the code lengths are stored (write()), the codes
+   *  follow from them: shorter codes come first and codes of equal length
+   *  are ordered by symbol.
+   *  @n Decoding looks up the next TABLE_BITS bits in a table that gives
+   *  symbol and code length at once. Only longer codes are searched length
+   *  by length.
+   *  @n All methods are templates of the stream type, so they work with
+   *  BitOStream, BitIStream and BitMemIStream.
+   *  @code
+   *    std::vector<unsigned long long> freqs(256);
+   *    for( size_t i=0; i<unSize; i++ )
+   *      freqs[(unsigned char)pch[i]]++;
+   *    tbd::HuffmanCode code;
+   *    code.build(&freqs[0],freqs.size());
+   *    code.write(bos);
+   *    code.putn(bos,(const unsigned char*)pch,unSize);
+   *    ...
+   *    tbd::HuffmanCode code;
+   *    code.read(bis);
+   *    code.getn(bis,puch,unSize);
+   *  @endcode
+   *  @ingroup BitStreams
+   */
+  class HuffmanCode
+  {
+  public:
+    enum
+    {
+      /// @brief Maximum code length.
+      MAX_LENGTH = 32,
+      /// @brief Number of bits that are decoded by one table lookup.
+      TABLE_BITS = 11
+    };
+    HuffmanCode() { clear(); }
+    /** @brief Builds the code from symbol frequencies.
+     *  @param pFreqs Frequency of each symbol. Symbols with frequency 0 get
+     *         no code.
+     *  @param unSymbols Number of symbols.
+     *  @param uMaxLength Maximum code length. The codes of rare symbols are
+     *         made shorter if necessary.
+     */
+    template<class F> void build( const F* pFreqs, size_t unSymbols, unsigned int uMaxLength=MAX_LENGTH )
+    {
+      BOOST_ASSERT( uMaxLength>0 && uMaxLength<=MAX_LENGTH );
+      // the lookup table keeps the symbol in 24 bits
+      BOOST_ASSERT( unSymbols<=0x1000000 );
+      // the used symbols, most frequent first
+      std::vector<unsigned int> vecUsed;
+      for( size_t i=0; i<unSymbols; i++ )
+        if( pFreqs[i] > 0 )
+          vecUsed.push_back((unsigned int)i);
+      std::stable_sort(vecUsed.begin(),vecUsed.end(),ByFreq<F>(pFreqs));
+      // there must be enough codes of the maximum length
+      while( !vecUsed.empty() && uMaxLength < MAX_LENGTH && (vecUsed.size()-1) >> uMaxLength )
+        uMaxLength++;
+      std::vector<unsigned char> vecLengths(unSymbols,0);
+      if( 1 == vecUsed.size() )
+        vecLengths[vecUsed[0]] = 1;
+      else if( vecUsed.size() > 1 )
+      {
+        // number of codes of each length
+        std::vector<size_t> vecCounts(uMaxLength+1,0);
+        countLengths(pFreqs,vecUsed,uMaxLength,vecCounts);
+        // shorter codes for the more frequent symbols
+        size_t i=0;
+        for( unsigned int uLen=1; uLen<=uMaxLength; uLen++ )
+          for( size_t n=0; n<vecCounts[uLen]; n++ )
+            vecLengths[vecUsed[i++]] = (unsigned char)uLen;
+      }
+      assign(vecLengths);
+    }
+    /** @brief Writes the code lengths into a bit stream.
+     *  @details
+     *  Number of symbols and the differences between the lengths of
+     *  neighbouring symbols as Exp-Golomb codes, so runs of equal lengths
+     *  take one bit per symbol.
+     */
+    template<class BS> void write( BS& bos ) const
+    {
+      bitcodec::putExpGolomb(bos,m_vecLengths.size(),0);
+      int nPrev=0;
+      for( size_t i=0; i<m_vecLengths.size(); i++ )
+      {
+        bitcodec::putExpGolomb(bos,bitcodec::zigzag((long long)m_vecLengths[i]-nPrev),0);
+        nPrev = m_vecLengths[i];
+      }
+    }
+    /// @brief Reads the code lengths written by write() and builds the
+    ///        code.
+    template<class BS> void read( BS& bis )
+    {
+      const unsigned long long ullSymbols = bitcodec::getExpGolomb(bis,0);
+      // symbols are stored as unsigned int
+      if( ullSymbols > 0x1000000u )
+        TBD_THROW(BitParseException(BitParseException::InvalidCode));
+      std::vector<unsigned char> vecLengths((size_t)ullSymbols);
+      long long llPrev=0;
+      for( size_t i=0; i<vecLengths.size(); i++ )
+      {
+        llPrev += bitcodec::unzigzag(bitcodec::getExpGolomb(bis,0));
+        if( llPrev < 0 || llPrev > MAX_LENGTH )
+          TBD_THROW(BitParseException(BitParseException::InvalidCode));
+        vecLengths[i] = (unsigned char)llPrev;
+      }
+      if( !assign(vecLengths) )
+        TBD_THROW(BitParseException(BitParseException::InvalidCode));
+    }
+    /** @brief Builds the code from code lengths.
+     *  @param vecLengths Code length of each symbol, 0 for symbols without
+     *         code.
+     *  @return false if the lengths don't describe a prefix code. The code
+     *          is empty then.
+     */
+    bool assign( const std::vector<unsigned char>& vecLengths )
+    {
+      clear();
+      std::vector<unsigned int> vecCounts(MAX_LENGTH+1,0);
+      for( size_t i=0; i<vecLengths.size(); i++ )
+      {
+        if( vecLengths[i] > MAX_LENGTH )
+        {
+          clear();
+          return false;
+        }
+        vecCounts[vecLengths[i]]++;
+        m_uMaxLength = std::max<unsigned int>(m_uMaxLength,vecLengths[i]);
+      }
+      // first code and index into m_vecSorted of each length
+      unsigned long long ullCode=0;
+      unsigned int uOffset=0;
+      for( unsigned int uLen=1; uLen<=m_uMaxLength; uLen++ )
+      {
+        ullCode <<= 1;
+        m_auFirst[uLen] = (unsigned int)ullCode;
+        m_auOffset[uLen] = uOffset;
+        m_auCount[uLen] = vecCounts[uLen];
+        ullCode += vecCounts[uLen];
+        uOffset += vecCounts[uLen];
+        // more codes than the length can hold
+        if( ullCode > (1ULL << uLen) )
+        {
+          clear();
+          return false;
+        }
+      }
+      m_vecLengths = vecLengths;
+      m_vecCodes.resize(vecLengths.size());
+      m_vecSorted.resize(uOffset);
+      // canonical codes in order of the symbols per length
+      std::vector<unsigned int> vecNext(m_auFirst,m_auFirst+MAX_LENGTH+1);
+      for( size_t i=0; i<vecLengths.size(); i++ )
+      {
+        const unsigned int uLen = vecLengths[i];
+        if( 0 == uLen )
+          continue;
+        m_vecSorted[m_auOffset[uLen]+vecNext[uLen]-m_auFirst[uLen]] = (unsigned int)i;
+        m_vecCodes[i] = vecNext[uLen]++;
+      }
+      // lookup table of the codes up to m_uTableBits bits
+      m_uTableBits = std::min<unsigned int>(m_uMaxLength,TABLE_BITS);
+      m_vecTable.assign(m_uTableBits ? (size_t)1 << m_uTableBits : 0,0);
+      for( size_t i=0; i<vecLengths.size(); i++ )
+      {
+        const unsigned int uLen = vecLengths[i];
+        if( 0 == uLen || uLen > m_uTableBits )
+          continue;
+        // all entries that start with the code
+        const size_t unFirst = (size_t)m_vecCodes[i] << (m_uTableBits-uLen);
+        const size_t unLast = unFirst + ((size_t)1 << (m_uTableBits-uLen));
+        for( size_t n=unFirst; n<unLast; n++ )
+          m_vecTable[n] = ((unsigned int)i << 8) | uLen;
+      }
+      return true;
+    }
+    /// @brief Removes all codes.
+    void clear()
+    {
+      m_vecLengths.clear();
+      m_vecCodes.clear();
+      m_vecSorted.clear();
+      m_vecTable.clear();
+      m_uMaxLength = m_uTableBits = 0;
+      std::fill(m_auFirst,m_auFirst+MAX_LENGTH+1,0);
+      std::fill(m_auOffset,m_auOffset+MAX_LENGTH+1,0);
+      std::fill(m_auCount,m_auCount+MAX_LENGTH+1,0);
+    }
+    /// @brief Returns the number of symbols.
+    size_t symbols() const { return m_vecLengths.size(); }
+    /// @brief Returns the code length of a symbol (0 if it has no code).
+    unsigned int length( unsigned int uSymbol ) const { return m_vecLengths[uSymbol]; }
+    /// @brief Returns the code of a symbol.
+    unsigned int code( unsigned int uSymbol ) const { return m_vecCodes[uSymbol]; }
+    /// @brief Returns the length of the longest code.
+    unsigned int maxLength() const { return m_uMaxLength; }
+    /// @brief Puts the code of a symbol into a bit stream.
+    template<class BS> __inline void put( BS& bos, unsigned int uSymbol ) const
+    {
+      BOOST_ASSERT( uSymbol<m_vecLengths.size() && 0<m_vecLengths[uSymbol] );
+      bos.put(m_vecCodes[uSymbol],m_vecLengths[uSymbol]);
+    }
+    /** @brief Puts the codes of some symbols into a bit stream.
+     *  @details
+     *  The codes are collected into 64 bit words, so there is one put() per
+     *  word instead of one per symbol.
+     */
+    template<class BS, class S> void putn( BS& bos, const S* psSymbols, size_t unNumSymbols ) const
+    {
+      unsigned long long ull=0;
+      unsigned int uBits=0;
+      for( size_t i=0; i<unNumSymbols; i++ )
+      {
+        const unsigned int uSymbol = (unsigned int)psSymbols[i];
+        BOOST_ASSERT( uSymbol<m_vecLengths.size() && 0<m_vecLengths[uSymbol] );
+        const unsigned int uLen = m_vecLengths[uSymbol];
+        if( uBits+uLen > 64 )
+        {
+          bos.put(ull,uBits);
+          ull = 0;
+          uBits = 0;
+        }
+        ull = (ull << uLen) | m_vecCodes[uSymbol];
+        uBits += uLen;
+      }
+      if( uBits > 0 )
+        bos.put(ull,uBits);
+    }
+    /// @brief Gets the next symbol from a bit stream.
+    template<class BS> __inline unsigned int get( BS& bis ) const
+    {
+      BOOST_ASSERT( !m_vecTable.empty() );
+      unsigned int uIndex;
+      const size_t unAvail = bis.lookahead(uIndex,m_uTableBits);
+      const unsigned int uEntry = m_vecTable[uIndex];
+      const unsigned int uLen = uEntry & 0xFF;
+      if( 0 < uLen && uLen <= unAvail )
+      {
+        bis.skip(uLen);
+        return uEntry >> 8;
+      }
+      return getLong(bis);
+    }
+    /// @brief Gets some symbols from a bit stream.
+    template<class BS, class S> void getn( BS& bis, S* psSymbols, size_t unNumSymbols ) const
+    {
+      for( size_t i=0; i<unNumSymbols; i++ )
+        psSymbols[i] = (S)get(bis);
+    }
+  protected:
+    /// @brief Orders symbols by descending frequency.
+    template<class F> struct ByFreq
+    {
+      ByFreq( const F* pFreqs ) : m_pFreqs(pFreqs) {}
+      bool operator()( unsigned int u1, unsigned int u2 ) const { return m_pFreqs[u1] > m_pFreqs[u2]; }
+      const F* m_pFreqs;
+    };
+    /** @brief Counts the Huffman code lengths of the used symbols.
+     *  @details
+     *  Codes longer than uMaxLength are cut to uMaxLength. Then the longest
+     *  codes that are still shorter get one bit more until the lengths
+     *  describe a prefix code again.
+     */
+    template<class F> static void countLengths( const F* pFreqs, const std::vector<unsigned int>& vecUsed, unsigned int uMaxLength, std::vector<size_t>& vecCounts )
+    {
+      typedef std::pair<unsigned long long,size_t> Node;
+      std::priority_queue< Node, std::vector<Node>, std::greater<Node> > queue;
+      // leaves first, then the inner nodes in order of creation
+      std::vector<size_t> vecParents(2*vecUsed.size()-1,0);
+      for( size_t i=0; i<vecUsed.size(); i++ )
+        queue.push(Node((unsigned long long)pFreqs[vecUsed[i]],i));
+      for( size_t n=vecUsed.size(); queue.size()>1; n++ )
+      {
+        const Node node1 = queue.top(); queue.pop();
+        const Node node2 = queue.top(); queue.pop();
+        vecParents[node1.second] = vecParents[node2.second] = n;
+        queue.push(Node(node1.first+node2.first,n));
+      }
+      // depths from the root (the last node) down
+      std::vector<unsigned int> vecDepths(vecParents.size(),0);
+      for( size_t n=vecParents.size()-1; n-->0; )
+      {
+        vecDepths[n] = vecDepths[vecParents[n]]+1;
+        if( n < vecUsed.size() )
+          vecCounts[std::min(vecDepths[n],uMaxLength)]++;
+      }
+      // Kraft sum in units of the longest code
+      unsigned long long ullKraft=0;
+      for( unsigned int uLen=1; uLen<=uMaxLength; uLen++ )
+        ullKraft += vecCounts[uLen] << (uMaxLength-uLen);
+      while( ullKraft > (1ULL << uMaxLength) )
+      {
+        unsigned int uLen = uMaxLength-1;
+        while( 0 == vecCounts[uLen] )
+          uLen--;
+        vecCounts[uLen]--;
+        vecCounts[uLen+1]++;
+        ullKraft -= 1ULL << (uMaxLength-uLen-1);
+      }
+    }
+    /// @brief Gets a code that is longer than m_uTableBits.
+    template<class BS> unsigned int getLong( BS& bis ) const
+    {
+      unsigned int uBits;
+      const size_t unAvail = bis.lookahead(uBits,m_uMaxLength);
+      for( unsigned int uLen=m_uTableBits+1; uLen<=m_uMaxLength && uLen<=unAvail; uLen++ )
+      {
+        const unsigned int uCode = uBits >> (m_uMaxLength-uLen);
+        if( uCode-m_auFirst[uLen] < m_auCount[uLen] )
+        {
+          bis.skip(uLen);
+          return m_vecSorted[m_auOffset[uLen]+uCode-m_auFirst[uLen]];
+        }
+      }
+      if( unAvail < m_uMaxLength )
+        TBD_THROW(BitParseException(BitParseException::UnexpectedEndOfFile));
+      TBD_THROW(BitParseException(BitParseException::InvalidCode));
+    }
+  private:
+    /// @brief Code length of each symbol.
+    std::vector<unsigned char>  m_vecLengths;
+    /// @brief Code of each symbol.
+    std::vector<unsigned int>   m_vecCodes;
+    /// @brief Symbols in order of their codes.
+    std::vector<unsigned int>   m_vecSorted;
+    /// @brief Symbol << 8 | code length for each m_uTableBits bit prefix,
+    ///        0 for prefixes of longer codes.
+    std::vector<unsigned int>   m_vecTable;
+    unsigned int                m_uMaxLength;
+    unsigned int                m_uTableBits;
+    /// @brief First code of each length.
+    unsigned int                m_auFirst[MAX_LENGTH+1];
+    /// @brief Index into m_vecSorted of the first code of each length.
+    unsigned int                m_auOffset[MAX_LENGTH+1];
+    /// @brief Number of codes of each length.
+    unsigned int                m_auCount[MAX_LENGTH+1];
+  };
+}
+
+#endif
@@ -11,6 +11,10 @@
 #include "bit.h"
 #include "stream.h"
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <new>
+#include <stdlib.h>
 #include <boost/numeric/conversion/cast.hpp>
 
 /** @defgroup MemStream Memory Streams
@@ -47,6 +51,10 @@ namespace tbd
     {
       return m_pBuffer;
     }
+    const T* buffer() const
+    {
+      return m_pBuffer;
+    }
     size_t size() const { return m_size; }
     bool empty() const
     {
@@ -98,6 +106,21 @@ namespace tbd
         failed();
       }
     }
+    const char* borrow(size_t _size)
+    {
+      if (_size > base::size() - m_g)
+        return NULL;
+      const char* p = ((const char*)base::buffer()) + m_g;
+      m_g += _size;
+      m_gcount = _size;
+      ok();
+      return p;
+    }
+    const char* window(size_t& _size) const
+    {
+      _size = base::size() - m_g;
+      return ((const char*)base::buffer()) + m_g;
+    }
     int peek()
     {
       if (base::size() - m_g >= 1)
@@ -171,8 +194,7 @@ namespace tbd
     /// @brief Destructor
     ~AutoMemIStream()
     {
-      if( base::buffer() )
-        delete base::buffer();
+      delete[] m_pBuffer;
     }
     T* release(size_t* _size=NULL) { if (_size) *_size = base::size(); T* p=m_pBuffer; m_pBuffer = NULL; base::clear(); return p; }
   private:
@@ -190,17 +212,37 @@ namespace tbd
   public:
     typedef MemStreamBase<SP,T> base;
     typedef SP streampos;
-    /// @brief Constructor
-    MemOStream(size_t grow = 1024, streampos start=0) :
-      base(NULL,0,start), m_reserved(0), m_grow(grow), m_p(0)
+    /// @brief How the buffer grows when it is full.
+    enum GrowthPolicy
+    {
+      /// @brief grow in steps of the grow size
+      GP_LINEAR,
+      /// @brief at least double the buffer (amortized linear copying)
+      GP_GEOMETRIC
+    };
+    /// @brief How the buffer is allocated.
+    enum AllocMode
+    {
+      /// @brief new[] (free detached buffers with delete[])
+      AM_NEW,
+      /// @brief malloc()/realloc() which can grow large buffers in place
+      ///        (free detached buffers with free())
+      AM_MALLOC
+    };
+    /** @brief Constructor
+     *  @param grow Step size (GP_LINEAR) or minimum step size (GP_GEOMETRIC)
+     *         in which the buffer grows.
+     *  @param start Position of the first byte.
+     *  @param eGrowth Growth policy.
+     *  @param eAlloc Allocation mode.
+     */
+    MemOStream(size_t grow = 1024, streampos start=0, GrowthPolicy eGrowth=GP_LINEAR, AllocMode eAlloc=AM_NEW) :
+      base(NULL,0,start), m_reserved(0), m_grow(grow), m_p(0), m_eGrowth(eGrowth), m_eAlloc(eAlloc)
     {
     }
     virtual ~MemOStream()
     {
-      if ( base::buffer() )
-      {
-        delete[] base::buffer();
-      }
+      deallocate();
     }
     bool is_open() const { return base::is_open(); }
     /** @brief Write size bytes from pch into this stream.
@@ -211,7 +253,9 @@ namespace tbd
     {
       if (m_reserved - m_p < _size)
       {
-        if (_size > m_grow)
+        if (GP_GEOMETRIC == m_eGrowth)
+          resize(m_p + _size);
+        else if (_size > m_grow)
           resize(m_p + (_size / m_grow + 1) * m_grow);
         else
           resize(m_p + m_grow);
@@ -221,6 +265,21 @@ namespace tbd
       std::copy(pch, pch+_size, (char*)base::buffer() + m_p);
       m_p += _size;
     }
+    /** @brief Write count memory blocks into this stream.
+     *  @details Reserves the memory for all blocks at once.
+     *  @param iov Array of memory blocks to write.
+     *  @param count Number of blocks in iov.
+     */
+    void writev(const iovec* iov, size_t count)
+    {
+      size_t _size = 0;
+      for (size_t i = 0; i < count; i++)
+        _size += iov[i].iov_len;
+      if (m_reserved - m_p < _size)
+        resize(m_p + _size);
+      for (size_t i = 0; i < count; i++)
+        write((const T*) iov[i].iov_base, iov[i].iov_len);
+    }
     /// @brief Returns the current write position.
     streampos tellp() const
     {
@@ -248,6 +307,32 @@ namespace tbd
       base::size(0);
       m_p = 0;
     }
+    /** @brief Make sure that the buffer can take at least _size bytes without
+     *         growing.
+     *  @details Use this if the size of the output is known (or can be
+     *  estimated) in advance.
+     *  @param _size Number of bytes to reserve.
+     */
+    void reserve(size_t _size)
+    {
+      if (_size > m_reserved)
+        resize(_size);
+    }
+    /// @brief Returns the size of the buffer.
+    size_t reserved() const { return m_reserved; }
+    GrowthPolicy growth() const { return m_eGrowth; }
+    AllocMode alloc() const { return m_eAlloc; }
+    /** @brief Frees a buffer that has been detached from a stream.
+     *  @param pBuffer The detached buffer.
+     *  @param eAlloc Allocation mode of the stream it was detached from.
+     */
+    static void deallocate(T* pBuffer, AllocMode eAlloc)
+    {
+      if (AM_MALLOC == eAlloc)
+        ::free((void*) pBuffer);
+      else
+        delete[] pBuffer;
+    }
     template<class PTR_TYPE> void snap(PTR_TYPE& pBuffer, size_t& _size)
     {
       pBuffer = base::buffer();
@@ -266,11 +351,17 @@ namespace tbd
       _reserved = m_reserved;
       detach();
     }
+    /** @brief Takes the buffer away from this stream.
+     *  @details The caller gets the ownership of the buffer and has to free it
+     *  with delete[] or free() depending on alloc() (see deallocate()).
+     */
     std::pair<T*,size_t> detach()
     {
       std::pair<T*,size_t> r(base::buffer(),base::size());
       base::buffer(NULL);
       base::size(0);
+      m_reserved = 0;
+      m_p = 0;
       return r;
     }
     bool isTemporary() const { return true; }
@@ -281,11 +372,36 @@ namespace tbd
      */
     void resize(size_t _size)
     {
-      m_reserved = (_size / m_grow + 1) * m_grow;
-      char* pBuf = new char[m_reserved];
-      memcpy(pBuf, base::buffer(), base::size());
-      delete[] base::buffer();
-      base::buffer(pBuf);
+      size_t reserved = (_size / m_grow + 1) * m_grow;
+      // grow at least about the current size
+      if (GP_GEOMETRIC == m_eGrowth && reserved < 2 * m_reserved)
+        reserved = 2 * m_reserved;
+      if (AM_MALLOC == m_eAlloc)
+      {
+        // large blocks grow by remapping instead of copying
+        void* pBuf = ::realloc((void*) base::buffer(), reserved);
+        if (NULL == pBuf)
+          throw std::bad_alloc();
+        base::buffer((T*) pBuf);
+      }
+      else
+      {
+        char* pBuf = new char[reserved];
+        if (base::size())
+          memcpy(pBuf, base::buffer(), base::size());
+        delete[] base::buffer();
+        base::buffer(pBuf);
+      }
+      m_reserved = reserved;
+    }
+    /// @brief Frees the buffer.
+    void deallocate()
+    {
+      if (base::buffer())
+        deallocate(base::buffer(), m_eAlloc);
+      base::clear();
+      m_reserved = 0;
+      m_p = 0;
     }
   private:
     /// @brief Size of the current memory piece.
@@ -294,6 +410,228 @@ namespace tbd
     size_t m_grow;
     /// @brief current write position.
     size_t m_p;
+    GrowthPolicy m_eGrowth;
+    AllocMode    m_eAlloc;
+  };
+  /** @brief Memory output stream that stores its content in fixed size
+   *         segments.
+   *  @details
+   *  Unlike MemOStream this stream never moves bytes that have already been
+   *  written, so growing costs no copying at all. The segments can be handed
+   *  over to a gathered write (see segments() and writeTo()) or copied into
+   *  one contiguous buffer with flatten(). Already written bytes can be
+   *  overwritten after seekp() (e.g. to patch size fields).
+   *  @ingroup MemStream
+   */
+  template<class SP=size_t> class SegmentedOStream: public OStream<SP>
+  {
+  IMPLEMENT_OSTREAM_OPERATORS(SegmentedOStream,SP)
+  public:
+    typedef SP streampos;
+    /** @brief Constructor
+     *  @param segment Size of each segment.
+     *  @param start Position of the first byte.
+     */
+    SegmentedOStream(size_t segment = 64*1024, streampos start=0) :
+      m_segment(segment), m_size(0), m_p(0), m_start(start)
+    {
+      BOOST_ASSERT(segment > 0);
+    }
+    virtual ~SegmentedOStream()
+    {
+      for (size_t i = 0; i < m_segments.size(); i++)
+        delete[] m_segments[i];
+    }
+    bool is_open() const { return m_size > 0; }
+    /** @brief Write size bytes from pch into this stream.
+     *  @param pch Pointer to the content to write.
+     *  @param _size Size of the content.
+     */
+    void write(const char* pch, size_t _size)
+    {
+      // fill a gap behind the end with zeros
+      while (m_size < m_p)
+        put(m_size, NULL, m_p - m_size);
+      put(m_p, pch, _size);
+      m_p += _size;
+    }
+    /// @brief Returns the current write position.
+    streampos tellp() const
+    {
+      return m_start + boost::numeric_cast<streampos>(m_p);
+    }
+    /// @brief Sets the current write position.
+    void seekp(const streampos& p)
+    {
+      if (p < m_start)
+        BOOST_ASSERT(0);
+      m_p = boost::numeric_cast<size_t>(p - m_start);
+    }
+    void seekp2end()
+    {
+      m_p = m_size;
+    }
+    void flush()
+    {
+    }
+    /// @brief Empties the stream but keeps the segments for reuse.
+    void reset()
+    {
+      m_size = 0;
+      m_p = 0;
+    }
+    bool isTemporary() const { return true; }
+    /// @brief Returns the number of written bytes.
+    size_t size() const { return m_size; }
+    bool empty() const { return 0 == m_size; }
+    /// @brief Returns the size of each segment.
+    size_t segmentSize() const { return m_segment; }
+    /** @brief Describes the written content as a list of memory blocks.
+     *  @param iov Gets one block for each used segment.
+     *  @return Number of blocks.
+     */
+    size_t segments(std::vector<iovec>& iov) const
+    {
+      iov.clear();
+      for (size_t pos = 0; pos < m_size; pos += m_segment)
+      {
+        iovec block;
+        block.iov_base = m_segments[pos / m_segment];
+        block.iov_len = std::min(m_segment, m_size - pos);
+        iov.push_back(block);
+      }
+      return iov.size();
+    }
+    /// @brief Writes the whole content into os with one gathered write.
+    template<class O> void writeTo(O& os) const
+    {
+      std::vector<iovec> iov;
+      if (0 < segments(iov))
+        tbd::writev(os, &iov[0], iov.size());
+    }
+    /// @brief Copies the whole content to pch which has to take size() bytes.
+    void copy(char* pch) const
+    {
+      for (size_t pos = 0; pos < m_size; pos += m_segment)
+        ::memcpy(pch + pos, m_segments[pos / m_segment], std::min(m_segment, m_size - pos));
+    }
+    /** @brief Copies the whole content into one contiguous buffer.
+     *  @return The buffer which has to be freed with delete[] and its size.
+     */
+    std::pair<char*,size_t> flatten() const
+    {
+      std::pair<char*,size_t> r(new char[m_size], m_size);
+      copy(r.first);
+      return r;
+    }
+  private:
+    SegmentedOStream(const SegmentedOStream&);
+    SegmentedOStream& operator=(const SegmentedOStream&);
+    /// @brief Copies _size bytes from pch (or zeros if NULL) to position pos
+    ///        which must not be behind the end.
+    void put(size_t pos, const char* pch, size_t _size)
+    {
+      while (_size > 0)
+      {
+        size_t index = pos / m_segment;
+        size_t offset = pos % m_segment;
+        if (index == m_segments.size())
+          m_segments.push_back(new char[m_segment]);
+        size_t n = std::min(_size, m_segment - offset);
+        if (NULL != pch)
+        {
+          ::memcpy(m_segments[index] + offset, pch, n);
+          pch += n;
+        }
+        else
+          ::memset(m_segments[index] + offset, 0, n);
+        pos += n;
+        _size -= n;
+        if (pos > m_size)
+          m_size = pos;
+      }
+    }
+    /// @brief Allocated segments.
+    std::vector<char*> m_segments;
+    /// @brief Size of each segment.
+    size_t      m_segment;
+    /// @brief Number of written bytes.
+    size_t      m_size;
+    /// @brief Current write position.
+    size_t      m_p;
+    /// @brief Position of the first byte.
+    streampos   m_start;
+  };
+  /** @brief Memory output stream that writes into a buffer of fixed size.
+   *  @details
+   *  The buffer is given by the caller (e.g. a slot in shared memory) and
+   *  never grows or gets freed by this stream. Writes that don't fit into
+   *  the buffer are dropped and let fail() return true.
+   *  @ingroup MemStream
+   */
+  template<class SP=size_t> class FixedMemOStream: public OStream<SP>
+  {
+  IMPLEMENT_OSTREAM_OPERATORS(FixedMemOStream,SP)
+  public:
+    typedef SP streampos;
+    /** @brief Constructor
+     *  @param pBuffer Buffer to write into.
+     *  @param capacity Size of the buffer.
+     *  @param start Position of the first byte.
+     */
+    FixedMemOStream(char* pBuffer, size_t capacity, streampos start=0) :
+      m_pBuffer(pBuffer), m_capacity(capacity), m_size(0), m_p(0), m_start(start), m_bFail(false)
+    {
+    }
+    bool is_open() const { return NULL != m_pBuffer; }
+    /** @brief Write size bytes from pch into this stream.
+     *  @param pch Pointer to the content to write.
+     *  @param _size Size of the content.
+     */
+    void write(const char* pch, size_t _size)
+    {
+      if (m_capacity - m_p < _size)
+      {
+        m_bFail = true;
+        return;
+      }
+      ::memcpy(m_pBuffer + m_p, pch, _size);
+      m_p += _size;
+      m_size = std::max(m_size, m_p);
+    }
+    /// @brief Returns the current write position.
+    streampos tellp() const { return m_start+boost::numeric_cast<streampos>(m_p); }
+    /// @brief Sets the current write position.
+    void seekp(const streampos& p)
+    {
+      if (p < m_start || p > m_start+boost::numeric_cast<streampos>(m_capacity))
+      {
+        m_bFail = true;
+        return;
+      }
+      m_p = boost::numeric_cast<size_t>(p-m_start);
+    }
+    void seekp2end() { m_p = m_size; }
+    void flush() { }
+    /// @brief Returns true if a write didn't fit into the buffer.
+    bool fail() const { return m_bFail; }
+    /// @brief Returns the number of bytes written.
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_capacity; }
+    char* buffer() { return m_pBuffer; }
+    const char* buffer() const { return m_pBuffer; }
+  private:
+    /// @brief Buffer given by the caller.
+    char*     m_pBuffer;
+    /// @brief Size of the buffer.
+    size_t    m_capacity;
+    /// @brief Number of bytes written.
+    size_t    m_size;
+    /// @brief Current write position.
+    size_t    m_p;
+    /// @brief Position of the first byte.
+    streampos m_start;
+    bool      m_bFail;
   };
   /** @brief Memory output stream class.
    *  @details
@@ -310,16 +648,14 @@ namespace tbd
     typedef MemStreamBase<SP,T> base;
     typedef SP                  streampos;
     /// @brief Constructor
-    MemStream(size_t grow = 1024, streampos start=0) :
-      base(NULL,0,start), gbase(NULL,0,start), pbase(grow,start)
+    MemStream(size_t grow = 1024, streampos start=0, typename pbase::GrowthPolicy eGrowth=pbase::GP_LINEAR, typename pbase::AllocMode eAlloc=pbase::AM_NEW) :
+      base(NULL,0,start), gbase(NULL,0,start), pbase(grow,start,eGrowth,eAlloc)
     {
     }
     /// @brief Destructor
     virtual ~MemStream()
     {
-      if (pbase::buffer())
-        delete[] pbase::buffer();
-      base::clear();
+      pbase::deallocate();
     }
     bool is_open() const { return base::is_open(); }
     T* buffer() { return base::buffer(); }
@@ -0,0 +1,237 @@
+///////////////////////////////////////////////////////////////////////////////
+/// @file mmapstream.h
+/// @brief Memory mapped file input stream based on basic stream intefaces
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TBD__MMAPSTREAM_H
+#define __TBD__MMAPSTREAM_H
+
+#include "stream.h"
+#include "filestream.h"
+
+#include <string.h>
+#include <limits>
+
+#if defined(_WIN32) || defined(_WIN64)
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+#endif
+
+namespace tbd
+{
+  /** @brief Input stream that reads a file through a memory mapping.
+   *  @details
+   *  The whole file is mapped read only into the address space when it is
+   *  opened. All reads are served from the mapping, so there are no read or
+   *  seek system calls and peek() is a plain memory access. Use this instead
+   *  of FileIStream to parse (huge) files with BinIStream, BitIStream or the
+   *  XML reader.
+   *  @attention On 32 bit systems the file has to fit into the address space.
+   *  @ingroup FileStreams
+   */
+  class MmapIStream
+    : public IStream<huge_streampos>
+  {
+    IMPLEMENT_ISTREAM_OPERATORS(MmapIStream,huge_streampos);
+  public:
+    typedef huge_streampos streampos;
+    /// @brief Constructor
+    MmapIStream() : m_pchData(NULL), m_unSize(0), m_unG(0), m_unGCount(0), m_bOpen(false), m_bFail(false) {}
+    /// @brief Constructor opening a file
+    MmapIStream( const std::string& rcFilename ) : m_pchData(NULL), m_unSize(0), m_unG(0), m_unGCount(0), m_bOpen(false), m_bFail(false)
+    { open(rcFilename); }
+    /// @brief Destructor
+    ~MmapIStream() { close(); }
+    /** @brief Map a file into memory.
+     *  @param rcFilename Name of the file to map.
+     *  @return true if the file could be mapped, false otherwise.
+     */
+    bool open( const std::string& rcFilename )
+    {
+      if( is_open() )
+      {
+        // file already opened
+        BOOST_ASSERT(0);
+        return false;
+      }
+      m_unG = m_unGCount = 0;
+      m_bFail = !map(rcFilename);
+      m_bOpen = !m_bFail;
+      return m_bOpen;
+    }
+    /// @brief Remove the mapping.
+    void close()
+    {
+      if( NULL != m_pchData )
+      {
+#if defined( _WIN32 )
+        ::UnmapViewOfFile(m_pchData);
+#else
+        ::munmap((void*)m_pchData,m_unSize);
+#endif
+      }
+      m_pchData = NULL;
+      m_unSize = m_unG = m_unGCount = 0;
+      m_bOpen = false;
+    }
+    virtual bool is_open() const { return m_bOpen; }
+    /** @brief Read up to size bytes from this stream to pch.
+     *  @param pch Pointer to a piece of memory of at least size bytes length.
+     *  @param size Maximum number of bytes to read.
+     */
+    virtual void read( char* pch, size_t size )
+    {
+      if( size > m_unSize - m_unG )
+        size = m_unSize - m_unG;
+      m_unGCount = size;
+      if( size > 0 )
+      {
+        ::memcpy(pch,m_pchData+m_unG,size);
+        m_unG += size;
+        m_bFail = false;
+      }
+      else
+        m_bFail = true;
+    }
+    virtual const char* borrow( size_t size )
+    {
+      if( size > m_unSize - m_unG )
+        return NULL;
+      const char* p = m_pchData + m_unG;
+      m_unG += size;
+      m_unGCount = size;
+      m_bFail = false;
+      return p;
+    }
+    virtual const char* window( size_t& size ) const
+    {
+      size = m_unSize - m_unG;
+      return m_pchData + m_unG;
+    }
+    virtual int peek()
+    {
+      if( m_unG < m_unSize )
+      {
+        m_bFail = false;
+        return (unsigned char)m_pchData[m_unG];
+      }
+      m_bFail = true;
+      return -1;
+    }
+    virtual void unget()
+    {
+      if( m_unG > 0 )
+        m_unG--;
+      else
+        m_bFail = true;
+    }
+    /// @brief Returns the current read position.
+    virtual streampos tellg() const { return (streampos)m_unG; }
+    /// @brief Sets the current read position.
+    virtual void seekg( const streampos& g )
+    {
+      if( g >= 0 && (size_t)g <= m_unSize )
+      {
+        m_unG = (size_t)g;
+        m_bFail = false;
+      }
+      else
+        m_bFail = true;
+    }
+    virtual void seekg2end() { m_unG = m_unSize; }
+    virtual streampos gcount() const { return (streampos)m_unGCount; }
+    virtual bool fail() const { return m_bFail; }
+    /// @brief Returns a pointer to the begin of the mapped file.
+    const char* data() const { return m_pchData; }
+    /// @brief Returns the size of the mapped file.
+    streampos size() const { return (streampos)m_unSize; }
+  private:
+    bool map( const std::string& rcFilename )
+    {
+#if defined( _WIN32 )
+      HANDLE hFile = ::CreateFileA(rcFilename.c_str(),GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+      if( INVALID_HANDLE_VALUE == hFile )
+        return false;
+      LARGE_INTEGER size;
+      if( !::GetFileSizeEx(hFile,&size) || (unsigned long long)size.QuadPart > (std::numeric_limits<size_t>::max)() )
+      {
+        ::CloseHandle(hFile);
+        return false;
+      }
+      m_unSize = (size_t)size.QuadPart;
+      // empty files can't be mapped but are valid
+      if( 0 == m_unSize )
+      {
+        ::CloseHandle(hFile);
+        return true;
+      }
+      HANDLE hMapping = ::CreateFileMappingA(hFile,NULL,PAGE_READONLY,0,0,NULL);
+      ::CloseHandle(hFile);
+      if( NULL == hMapping )
+        return false;
+      m_pchData = (const char*)::MapViewOfFile(hMapping,FILE_MAP_READ,0,0,0);
+      ::CloseHandle(hMapping);
+      if( NULL == m_pchData )
+      {
+        m_unSize = 0;
+        return false;
+      }
+#else
+# if defined(__USE_LARGEFILE64)
+      int hFile = open64( rcFilename.c_str(), O_RDONLY );
+      struct stat64 filestat;
+      if( 0 > hFile || 0 != fstat64(hFile,&filestat) )
+# else
+      int hFile = ::open( rcFilename.c_str(), O_RDONLY );
+      struct stat filestat;
+      if( 0 > hFile || 0 != fstat(hFile,&filestat) )
+# endif
+      {
+        if( 0 <= hFile )
+          ::close(hFile);
+        return false;
+      }
+      if( (unsigned long long)filestat.st_size > (std::numeric_limits<size_t>::max)() )
+      {
+        ::close(hFile);
+        return false;
+      }
+      m_unSize = (size_t)filestat.st_size;
+      // empty files can't be mapped but are valid
+      if( 0 == m_unSize )
+      {
+        ::close(hFile);
+        return true;
+      }
+      void* p = ::mmap(NULL,m_unSize,PROT_READ,MAP_PRIVATE,hFile,0);
+      // the mapping keeps the file referenced
+      ::close(hFile);
+      if( MAP_FAILED == p )
+      {
+        m_unSize = 0;
+        return false;
+      }
+      // we usually parse from begin to end
+      ::madvise(p,m_unSize,MADV_SEQUENTIAL);
+      m_pchData = (const char*)p;
+#endif
+      return true;
+    }
+    /// @brief Begin of the mapped file.
+    const char* m_pchData;
+    /// @brief Size of the mapped file.
+    size_t      m_unSize;
+    /// @brief Current read position.
+    size_t      m_unG;
+    /// @brief Number of bytes read by the last read().
+    size_t      m_unGCount;
+    bool        m_bOpen;
+    bool        m_bFail;
+  };
+}
+#endif
@@ -7,6 +7,18 @@
 
 #include <boost/assert.hpp>
 #include <vector>
+#include <algorithm>
+#include <string.h>
+#include <boost/cstdint.hpp>
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSSE3__)
+# include <tmmintrin.h>
+#endif
+#if defined(_MSC_VER)
+# include <stdlib.h>
+#endif
 
 #ifndef __TBD__NETWORK_H
 #define __TBD__NETWORK_H
@@ -121,6 +133,121 @@ namespace tbd
   /// @ingroup Network
   template<class T> __inline int net2host(T& t, std::istream& is )
   { return host2net(t,is); }
+
+  namespace details
+  {
+    __inline boost::uint16_t bswap(boost::uint16_t u)
+    {
+#if defined(_MSC_VER)
+      return _byteswap_ushort(u);
+#else
+      return (boost::uint16_t)((u << 8) | (u >> 8));
+#endif
+    }
+    __inline boost::uint32_t bswap(boost::uint32_t u)
+    {
+#if defined(_MSC_VER)
+      return _byteswap_ulong(u);
+#elif defined(__GNUC__)
+      return __builtin_bswap32(u);
+#else
+      swapEndian(u);
+      return u;
+#endif
+    }
+    __inline boost::uint64_t bswap(boost::uint64_t u)
+    {
+#if defined(_MSC_VER)
+      return _byteswap_uint64(u);
+#elif defined(__GNUC__)
+      return __builtin_bswap64(u);
+#else
+      swapEndian(u);
+      return u;
+#endif
+    }
+    /// @brief Unsigned integer type of N bytes.
+    template<size_t N> struct Uint {};
+    template<> struct Uint<1> { typedef boost::uint8_t type; };
+    template<> struct Uint<2> { typedef boost::uint16_t type; };
+    template<> struct Uint<4> { typedef boost::uint32_t type; };
+    template<> struct Uint<8> { typedef boost::uint64_t type; };
+    /// @brief Reverses the bytes of n items of N bytes each.
+    template<size_t N> struct ByteSwap
+    {
+      static void run(char* pchDst, const char* pchSrc, size_t n)
+      {
+        typedef typename Uint<N>::type U;
+        size_t i=0;
+#if defined(__AVX2__) || defined(__SSSE3__)
+        // byte indices that reverse each item in 16 bytes
+        char achMask[16];
+        for( int j=0; j<16; j++ )
+          achMask[j] = (char)((j/N)*N + N-1-j%N);
+        const __m128i mask = _mm_loadu_si128((const __m128i*)achMask);
+# if defined(__AVX2__)
+        // both 128 bit lanes get the same shuffle
+        const __m256i mask2 = _mm256_broadcastsi128_si256(mask);
+        for( ; (i+32/N)<=n; i+=32/N )
+          _mm256_storeu_si256((__m256i*)(pchDst+i*N),_mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(pchSrc+i*N)),mask2));
+# endif
+        for( ; (i+16/N)<=n; i+=16/N )
+          _mm_storeu_si128((__m128i*)(pchDst+i*N),_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(pchSrc+i*N)),mask));
+#endif
+        // scalar for the rest
+        for( ; i<n; i++ )
+        {
+          U u;
+          memcpy(&u,pchSrc+i*N,N);
+          u = bswap(u);
+          memcpy(pchDst+i*N,&u,N);
+        }
+      }
+    };
+    template<> struct ByteSwap<1>
+    {
+      static void run(char* pchDst, const char* pchSrc, size_t n)
+      {
+        if( pchDst != pchSrc )
+          memmove(pchDst,pchSrc,n);
+      }
+    };
+  }
+  /** @brief Reverses the byte order of n items (see swapEndian()).
+   *  @details
+   *  Uses SSSE3 or AVX2 shuffles if the compiler targets them and scalar
+   *  byte swaps otherwise. Source and destination may be the same but must
+   *  not overlap otherwise. Both don't need to be aligned.
+   *  @param pvDst Memory that gets n converted items.
+   *  @param pvSrc Memory of n items of type T.
+   *  @param n Number of items.
+   *  @ingroup Network
+   */
+  template<class T> __inline void swapEndian(void* pvDst, const void* pvSrc, size_t n)
+  {
+    details::ByteSwap<sizeof(T)>::run((char*)pvDst,(const char*)pvSrc,n);
+  }
+  /// @brief Reverses the byte order of n items in place.
+  /// @ingroup Network
+  template<class T> __inline void swapEndian(T* pt, size_t n) { swapEndian<T>(pt,pt,n); }
+  /// @brief Converts n items from host to network byte order.
+  /// @param pvDst Memory that gets n items in network byte order (may be
+  ///        unaligned).
+  /// @param ptSrc Items in host byte order.
+  /// @param n Number of items.
+  /// @ingroup Network
+#ifdef TBD_LITTLE_ENDIAN
+  template<class T> __inline void host2net(void* pvDst, const T* ptSrc, size_t n) { swapEndian<T>(pvDst,ptSrc,n); }
+#else
+  template<class T> __inline void host2net(void* pvDst, const T* ptSrc, size_t n) { if( pvDst != ptSrc ) memmove(pvDst,ptSrc,n*sizeof(T)); }
+#endif
+  /// @brief Converts n items from network to host byte order.
+  /// @param ptDst Items that get the result in host byte order.
+  /// @param pvSrc Memory of n items in network byte order (may be
+  ///        unaligned).
+  /// @param n Number of items.
+  /// @ingroup Network
+  template<class T> __inline void net2host(T* ptDst, const void* pvSrc, size_t n) { host2net<T>((void*)ptDst,(const T*)pvSrc,n); }
 }
 
 #ifdef _MSC_VER
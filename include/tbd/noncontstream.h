@@ -12,6 +12,7 @@
 #include "exception.h"
 #include "memstream.h"
 #include <boost/foreach.hpp>
+#include <boost/next_prior.hpp>
 #include <boost/ptr_container/ptr_list.hpp>
 #include <limits>
 #include <algorithm>
@@ -89,7 +90,11 @@ namespace tbd
       bool      m_delete;
     };
     typedef boost::ptr_list<Block> BlockList;
+    /// @brief Blocks by their start positions.
+    typedef std::map<streampos, typename BlockList::iterator> Index;
   public:
+    /// @brief Map of gaps between the blocks (start -> end).
+    typedef std::map<streampos, streampos> Gaps;
     /** @brief create a non-continuous stream
      *  @param max maximum count of blocks before oldest blocks are deleted
      */
@@ -103,17 +108,24 @@ namespace tbd
      */
     void insert(stream_t* stream, streampos start, streampos end, const meta_t& meta, bool _delete)
     {
+      typename Index::iterator next = m_index.lower_bound(start);
       // check if new block would overlap existing ones
-      BOOST_FOREACH( Block& block, m_blocks )
-      {
-        BOOST_ASSERT( !block.overlaps(start,end) );
-      }
+      BOOST_ASSERT( next == m_index.end() || !next->second->overlaps(start,end) );
+      BOOST_ASSERT( next == m_index.begin() || !boost::prior(next)->second->overlaps(start,end) );
       // add new block
       m_blocks.push_back(new Block(stream, start, end, meta, _delete));
+      m_index.insert(next, std::make_pair(start, boost::prior(m_blocks.end())));
+      // the new block fills the gap it falls into
+      streampos pos = (next == m_index.begin() || boost::prior(next) == m_index.begin()) ? 0 : boost::prior(next,2)->second->m_end;
+      m_gaps.erase(pos);
+      if (start > pos)
+        m_gaps[pos] = start;
+      if (next != m_index.end() && next->first > end)
+        m_gaps[end] = next->first;
       // block count is exceeded maximum?
       if (m_blocks.size() > m_max)
         // drop block
-        m_blocks.pop_front();
+        erase(m_blocks.begin());
     }
     void insert(stream_t* stream, streampos start, streampos end, bool _delete) { insert( stream, start, end, meta_t(), _delete); }
     /** @brief Take ownership of the stream object of a block stored in the
@@ -123,22 +135,15 @@ namespace tbd
      */
     stream_t* release(streampos start)
     {
-      // through all blocks
-      for (typename BlockList::iterator it = m_blocks.begin(); it != m_blocks.end(); ++it)
-      {
-        // check if start an end position do match
-        if (it->m_start == start)
-        {
-          // take the stream
-          stream_t* stream = it->take();
-          // erase block
-          m_blocks.erase(it);
-          // return stream
-          return stream;
-        }
-      }
-      // error
-      TBD_THROW(NonContStreamException(NonContStreamException::BlockNotFound));
+      typename Index::iterator it = m_index.find(start);
+      if (it == m_index.end())
+        TBD_THROW(NonContStreamException(NonContStreamException::BlockNotFound));
+      // take the stream
+      stream_t* stream = it->second->take();
+      // erase block
+      erase(it->second);
+      // return stream
+      return stream;
     }
     template<class T> Block* find(const T& param, bool bThrowException=true)
     {
@@ -154,34 +159,36 @@ namespace tbd
     }
     void order(std::vector<const Block*>& result) const
     {
-      BOOST_FOREACH( const Block& block, m_blocks )
-        result.push_back(&block);
-      std::sort(result.begin(),result.end(),compareBlocks);
+      result.reserve(result.size() + m_index.size());
+      for (typename Index::const_iterator it = m_index.begin(); it != m_index.end(); ++it)
+        result.push_back(&*it->second);
     }
     Block* findvalid(streampos posFrom )
     {
       // find the block which is first after the given position
-      streampos posMin = std::numeric_limits<streampos>::max();
-      Block* result = 0;
-      BOOST_FOREACH( Block& block, m_blocks )
-      {
-        if( block.m_start >= posFrom && block.m_start < posMin )
-        {
-          posMin = block.m_start;
-          result = &block;
-        }
-      }
-      return result;
+      typename Index::iterator it = m_index.lower_bound(posFrom);
+      return it != m_index.end() ? &*it->second : 0;
     }
     template<class T> void discard(const T& param)
     {
-      for( typename BlockList::iterator it=m_blocks.begin(); it!=m_blocks.end(); it++ )
+      for( typename BlockList::iterator it=m_blocks.begin(); it!=m_blocks.end(); )
       {
         if (it->m_meta == param)
-          m_blocks.erase(it);
+          it = erase(it);
+        else
+          ++it;
       }
     }
-    void clear() { m_blocks.clear(); m_current = 0; }
+    void clear()
+    {
+      BOOST_FOREACH( Block& block, m_blocks )
+        erased(block);
+      m_blocks.clear(); m_index.clear(); m_gaps.clear(); m_current = 0;
+    }
+    /// @brief Returns the gaps between the blocks.
+    const Gaps& gaps() const { return m_gaps; }
+    /// @brief Returns the number of blocks.
+    size_t blocks() const { return m_blocks.size(); }
   protected:
     static bool compareBlocks( const Block * l, const Block * r ) { return l->m_start < r->m_start; }
     const Block* current() const { return m_current; }
@@ -189,35 +196,60 @@ namespace tbd
     Block* current(Block* f) { return m_current = f; }
     Block* find(streampos pos)
     {
-      // search for a block including the given position (using reverse search might optimize access)
-      BOOST_REVERSE_FOREACH( Block& block, m_blocks )
-      {
-        if (block.has(pos))
-          return &block;
-      }
-      return 0;
+      // stay in the current block if possible
+      if (m_current && m_current->has(pos))
+        return m_current;
+      // the block with the last start position in front of pos
+      typename Index::iterator it = m_index.upper_bound(pos);
+      if (it == m_index.begin())
+        return 0;
+      --it;
+      return it->second->has(pos) ? &*it->second : 0;
     }
     Block* last()
     {
-      Block* result=0;
-      // search for a block including the given position (using reverse search might optimize access)
-      BOOST_FOREACH( Block& block, m_blocks )
-      {
-        if (!result || block.m_end > result->m_end)
-          result = &block;
-      }
-      return result;
+      // blocks don't overlap, so the last one also ends last
+      return m_index.empty() ? 0 : &*m_index.rbegin()->second;
+    }
+    /// @brief Returns all blocks in the order they have been inserted.
+    BlockList& list() { return m_blocks; }
+    /// @brief Called before a block gets removed.
+    virtual void erased(Block&) { }
+    /// @brief Removes a block and updates index and gaps.
+    typename BlockList::iterator erase(typename BlockList::iterator it)
+    {
+      typename Index::iterator index = m_index.find(it->m_start);
+      BOOST_ASSERT(index != m_index.end());
+      // merge the gaps in front of and behind the block
+      streampos pos = index == m_index.begin() ? 0 : boost::prior(index)->second->m_end;
+      typename Index::iterator next = boost::next(index);
+      m_gaps.erase(pos);
+      m_gaps.erase(it->m_end);
+      if (next != m_index.end() && next->first > pos)
+        m_gaps[pos] = next->first;
+      m_index.erase(index);
+      if (m_current == &*it)
+        m_current = 0;
+      erased(*it);
+      return m_blocks.erase(it);
     }
   private:
     /// unsorted fragments
     BlockList m_blocks;
+    /// fragments sorted by start position
+    Index m_index;
+    /// gaps between the fragments
+    Gaps m_gaps;
     /// maximum number of fragments (if exceeded oldest fragments will be dropped
     size_t m_max;
     /// current block
     Block* m_current;
   };
-  /// @ingroup Streams
-  template<class ISTREAM, class META=int, size_t WRITE_SIZE=4096> class NonContIStream :
+  /** @ingroup Streams
+   *  @tparam WRITE_SIZE Size of the buffer save() uses if the blocks can't be
+   *          copied without it.
+   */
+  template<class ISTREAM, class META=int, size_t WRITE_SIZE=1024*1024> class NonContIStream :
     protected NonContStreamBase<ISTREAM,META>,
     public IStream<typename ISTREAM::streampos>
   {
@@ -250,6 +282,7 @@ namespace tbd
         stream_t* is=base::current()->stream();
         // read what we can get from the current block
         is->read(pch, size);
+        pch += is->gcount();
         size -= is->gcount();
         m_g += is->gcount();
         m_gcount += is->gcount();
@@ -278,48 +311,50 @@ namespace tbd
     /// @todo may be we should get STREAM::isTemporary() but the method is not static :(
     virtual bool isTemporary() const { return base::current() ? base::current()->stream()->isTemporary() : true; }
     virtual bool is_open() const { return base::current() ? base::current()->stream()->is_open() : false; }
-    typedef std::map<streampos, streampos> Gaps;
+    typedef typename base::Gaps Gaps;
     void gaps( Gaps& _gaps ) const
     {
-      std::vector<const Block*> ordered;
-      order(ordered);
-      streampos pos=0;
-      BOOST_FOREACH( const Block* block, ordered )
-      {
-        if( block->m_start > pos )
-          _gaps[pos] = block->m_start;
-        pos = block->m_end;
-      }
+      _gaps.insert(base::gaps().begin(), base::gaps().end());
     }
+    const Gaps& gaps() const { return base::gaps(); }
+    /** @brief Writes all blocks to their positions in os.
+     *  @details
+     *  Each block is copied with streamcopy(). So file blocks are copied inside
+     *  the kernel into file streams and memory blocks are written without an
+     *  intermediate copy.
+     *  @param os Stream to write to.
+     *  @param _gaps Gets the gaps between the blocks.
+     */
     template<class OSTREAM> void save( OSTREAM& os, Gaps& _gaps ) const
     {
       std::vector<Block const*> ordered;
-      order(ordered);
+      base::order(ordered);
       streampos pos=0;
-      std::pair<char*, streampos> buffer = std::get_temporary_buffer<char>(WRITE_SIZE);
+      // reusable buffer for blocks that need one
+      std::vector<char> buffer(WRITE_SIZE);
       BOOST_FOREACH( const Block* block, ordered )
       {
         if( block->m_start > pos )
           _gaps[pos] = block->m_start;
         os.seekp(block->m_start);
         block->m_stream->seekg(block->m_start);
-        for( streampos cp=block->size(); cp > 0; cp -= std::min(cp,buffer.second) )
-        {
-          block->m_stream->read(buffer.first, std::min(cp, buffer.second));
-          os.write(buffer.first, std::min(cp, buffer.second));
-        }
+        streamcopy(os, *block->m_stream, block->size(), buffer);
         pos = block->m_end;
       }
-      std::return_temporary_buffer(buffer.first);
     }
     void clear() { base::clear(); }
+    /// @brief Removes all blocks with the given meta data.
+    template<class T> void discard(const T& param) { base::discard(param); }
+    /// @brief Removes the block that starts at start and returns its stream.
+    stream_t* release(streampos start) { return base::release(start); }
+    size_t blocks() const { return base::blocks(); }
     template<class T> const meta_t& jumpg(const T& param)
     {
       static const meta_t nil=meta_t();
-      typename base::Block* f=find(param);
+      typename base::Block* f=base::find(param,false);
       if( f )
       {
-        current(f);
+        base::current(f);
         m_g = f->m_start;
         return f->m_meta;
       }
@@ -327,7 +362,7 @@ namespace tbd
     }
     void jumpg()
     {
-      typename base::Block* f=findvalid(tellg());
+      typename base::Block* f=base::findvalid(tellg());
       if( f )
         m_g = f->m_start;
       base::current(f);
@@ -337,29 +372,201 @@ namespace tbd
     streampos m_g;
     size_t m_gcount;
   };
+  /** @brief Non continuous stream that owns buffers given to insert().
+   *  @details
+   *  Optionally adjacent or overlapping buffers with equal meta data are
+   *  merged into one larger block (up to a maximum size), so reads don't hop
+   *  across many small blocks. Where buffers overlap the data that has been
+   *  inserted first is kept. The memory of owned buffers can be limited by a
+   *  byte budget: if it's exceeded the oldest owned blocks are dropped.
+   *  @ingroup Streams
+   */
   template<class ISTREAM, class META=int, class TEMPSTREAM=AutoMemIStream<typename ISTREAM::streampos> > class AutoNonContIStream :
     public NonContIStream<ISTREAM,META>
   {
     typedef NonContIStream<ISTREAM,META> base;
+    typedef typename base::base cbase;
+    typedef typename base::Block Block;
     typedef typename ISTREAM::streampos streampos;
     typedef ISTREAM stream_t;
     typedef META meta_t;
     typedef TEMPSTREAM tempstream_t;
   public:
-    AutoNonContIStream(std::size_t max = std::numeric_limits<std::size_t>::max()) :
-      base (max) { }
+    /// @brief Counters about merging and eviction.
+    struct Statistics
+    {
+      Statistics() : m_inserts(0), m_merges(0), m_copied(0), m_evictions(0), m_evicted(0) {}
+      /// @brief number of inserted buffers
+      size_t m_inserts;
+      /// @brief number of buffers that have been merged into other blocks
+      size_t m_merges;
+      /// @brief number of bytes copied by merging or clipping overlaps
+      size_t m_copied;
+      /// @brief number of blocks dropped because of the byte budget
+      size_t m_evictions;
+      /// @brief number of bytes dropped because of the byte budget
+      size_t m_evicted;
+    };
+    /** @brief Constructor
+     *  @param max maximum count of blocks before oldest blocks are deleted
+     *  @param budget maximum number of bytes in owned blocks before oldest
+     *         owned blocks are deleted
+     *  @param merge maximum size of merged blocks (0 = don't merge)
+     */
+    AutoNonContIStream(std::size_t max = std::numeric_limits<std::size_t>::max(),
+                       std::size_t budget = std::numeric_limits<std::size_t>::max(),
+                       std::size_t merge = 0) :
+      base (max), m_budget(budget), m_merge(merge), m_bytes(0) { }
+    /** @brief Insert a buffer and take its ownership.
+     *  @param buffer Buffer allocated with new[].
+     *  @param start Start position of the buffer.
+     *  @param end End position of the buffer.
+     *  @param meta User specified meta information.
+     *  @details
+     *  If the buffer can't be merged, only the parts no block covers yet are
+     *  inserted (existing data wins like in merge()).
+     */
     void insert(char* buffer, streampos start, streampos end, const meta_t& meta=meta_t())
-    { base::insert( new tempstream_t(buffer,end-start,start), start, end, meta, true); }
+    {
+      m_statistics.m_inserts++;
+      if( 0 == m_merge || !merge(buffer, start, end, meta) )
+        clip(buffer, start, end, meta);
+      evict();
+    }
     void insert(stream_t* pis, streampos start, streampos end, const meta_t& meta=meta_t(), bool _delete=false)
     { base::insert( pis, start, end, meta, _delete); }
     char* release( streampos start )
     {
       stream_t* pis=base::release(start);
-      if( dynamic_cast<tempstream_t*>(pis) )
-        return dynamic_cast<tempstream_t*>(pis)->release();
+      tempstream_t* pts=dynamic_cast<tempstream_t*>(pis);
+      if( pts )
+      {
+        m_bytes -= pts->size();
+        char* buffer = pts->release();
+        delete pts;
+        return buffer;
+      }
       else
         return 0;
     }
+    /// @brief Sets the maximum number of bytes in owned blocks.
+    void budget(std::size_t _budget) { m_budget = _budget; evict(); }
+    std::size_t budget() const { return m_budget; }
+    /// @brief Sets the maximum size of merged blocks (0 = don't merge).
+    void merge(std::size_t _merge) { m_merge = _merge; }
+    std::size_t merge() const { return m_merge; }
+    /// @brief Returns the number of bytes in owned blocks.
+    std::size_t bytes() const { return m_bytes; }
+    const Statistics& statistics() const { return m_statistics; }
+    void resetStatistics() { m_statistics = Statistics(); }
+  protected:
+    virtual void erased(Block& block)
+    {
+      if( block.m_delete && dynamic_cast<tempstream_t*>(block.stream()) )
+        m_bytes -= block.size();
+    }
+  private:
+    /// @brief Returns true if a buffer with meta can be merged into block.
+    bool mergeable(const Block* block, const meta_t& meta) const
+    {
+      return block && block->m_delete && block->m_meta == meta && dynamic_cast<const tempstream_t*>(block->stream());
+    }
+    /// @brief Merge a buffer with all adjacent or overlapping blocks.
+    /// @return false if there is nothing to merge or merging isn't possible.
+    bool merge(char* buffer, streampos start, streampos end, const meta_t& meta)
+    {
+      // collect the blocks that touch [start,end)
+      std::vector<Block*> blocks;
+      Block* block = 0 < start ? cbase::find(start-1) : 0;
+      if( block )
+        blocks.push_back(block);
+      for( block = cbase::findvalid(start); block && block->m_start <= end; block = cbase::findvalid(block->m_end) )
+        blocks.push_back(block);
+      if( blocks.empty() )
+        return false;
+      streampos mstart = std::min(start, blocks.front()->m_start);
+      streampos mend = std::max(end, blocks.back()->m_end);
+      if( mend - mstart > (streampos)m_merge )
+        return false;
+      BOOST_FOREACH( const Block* b, blocks )
+      {
+        if( !mergeable(b, meta) )
+          return false;
+      }
+      // new data first
+      char* merged = new char[mend-mstart];
+      ::memcpy(merged + (start-mstart), buffer, end-start);
+      delete[] buffer;
+      m_statistics.m_copied += end-start;
+      // existing data wins
+      BOOST_FOREACH( Block* b, blocks )
+      {
+        ::memcpy(merged + (b->m_start-mstart), ((const tempstream_t*)b->stream())->buffer(), b->size());
+        m_statistics.m_copied += b->size();
+        delete[] release(b->m_start);
+      }
+      base::insert( new tempstream_t(merged,mend-mstart,mstart), mstart, mend, meta, true);
+      m_bytes += mend-mstart;
+      m_statistics.m_merges++;
+      return true;
+    }
+    /// @brief Insert the parts of a buffer that don't overlap any block.
+    void clip(char* buffer, streampos start, streampos end, const meta_t& meta)
+    {
+      // collect the ranges of [start,end) that aren't covered yet
+      typedef std::pair<streampos,streampos> Piece;
+      std::vector<Piece> pieces;
+      streampos pos = start;
+      Block* block = cbase::find(start);
+      if( block )
+        pos = std::min(block->m_end, end);
+      while( pos < end )
+      {
+        block = cbase::findvalid(pos);
+        streampos next = block ? std::min(block->m_start, end) : end;
+        if( next > pos )
+          pieces.push_back(std::make_pair(pos, next));
+        pos = block ? std::max(pos, std::min(block->m_end, end)) : end;
+      }
+      if( 1 == pieces.size() && pieces.front().first == start && pieces.front().second == end )
+      {
+        base::insert( new tempstream_t(buffer,end-start,start), start, end, meta, true);
+        m_bytes += end-start;
+        return;
+      }
+      BOOST_FOREACH( const Piece& piece, pieces )
+      {
+        char* part = new char[piece.second-piece.first];
+        ::memcpy(part, buffer + (piece.first-start), piece.second-piece.first);
+        m_statistics.m_copied += piece.second-piece.first;
+        base::insert( new tempstream_t(part,piece.second-piece.first,piece.first), piece.first, piece.second, meta, true);
+        m_bytes += piece.second-piece.first;
+      }
+      delete[] buffer;
+    }
+    /// @brief Drop the oldest owned blocks until the byte budget is kept.
+    void evict()
+    {
+      typename cbase::BlockList& blocks = cbase::list();
+      for( typename cbase::BlockList::iterator it = blocks.begin(); m_bytes > m_budget && it != blocks.end(); )
+      {
+        if( it->m_delete && dynamic_cast<tempstream_t*>(it->stream()) )
+        {
+          m_statistics.m_evictions++;
+          m_statistics.m_evicted += it->size();
+          it = cbase::erase(it);
+        }
+        else
+          ++it;
+      }
+    }
+    /// maximum number of bytes in owned blocks
+    std::size_t m_budget;
+    /// maximum size of merged blocks
+    std::size_t m_merge;
+    /// number of bytes in owned blocks
+    std::size_t m_bytes;
+    Statistics m_statistics;
   };
 }
 
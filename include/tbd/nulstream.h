@@ -8,6 +8,7 @@
 #ifndef __TBD__NULSTREAM_H
 #define __TBD__NULSTREAM_H
 
+#include "stream.h"
 #include <algorithm>
 
 /// @defgroup NulStream NUL Stream
@@ -21,7 +22,9 @@ namespace tbd
   template <class SP=size_t> class NulOStream
     : public OStream<SP>
   {
+  public:
     typedef SP streampos;
+  private:
     streampos m_size;
     streampos m_pos;
   public:
@@ -17,9 +17,12 @@
 # include <share.h>
 #else
 # include <unistd.h>
+# include <sys/uio.h>
 #endif
 
+#include <string.h>
 #include <string>
+#include <vector>
 
 /** @defgroup streams Streams
  *  @brief Several streaming classes
@@ -27,6 +30,18 @@
  */
 namespace tbd
 {
+#if defined(_WIN32) || defined(_WIN64)
+  /// @brief Memory block description for gathered writes (see OStream::writev()).
+  struct iovec
+  {
+    /// @brief Begin of the memory block.
+    void*  iov_base;
+    /// @brief Size of the memory block.
+    size_t iov_len;
+  };
+#else
+  using ::iovec;
+#endif
   /// @ingroup Streams
   template<class SP = size_t> class Stream
   {
@@ -76,6 +91,24 @@ namespace tbd
       read((char*) t, n * sizeof(T));
     }
     virtual void unget() { seekg(tellg()-1); }
+    /** @brief Borrow the next size bytes of this stream without copying.
+     *  @details
+     *  Streams that store their content contiguously in memory return a
+     *  pointer to the next size bytes and move the read position behind them.
+     *  The content stays valid as long as the storage of the stream exists.
+     *  All other streams return NULL and leave the read position unchanged.
+     *  @param size Number of bytes to borrow.
+     *  @return Pointer to the borrowed bytes or NULL.
+     */
+    virtual const char* borrow(size_t /*size*/) { return NULL; }
+    /** @brief Returns the contiguous memory beginning at the read position.
+     *  @details
+     *  The read position won't be changed. Streams that can't provide
+     *  contiguous memory return NULL and set size to 0.
+     *  @param size Gets the number of bytes in the window.
+     *  @return Pointer to the current read position or NULL.
+     */
+    virtual const char* window(size_t& size) const { size = 0; return NULL; }
     virtual int peek() {
       streampos g=tellg();
       // paranoia checks
@@ -108,6 +141,19 @@ namespace tbd
     virtual void seekp(const streampos& p) = 0;
     virtual void seekp2end() = 0;
     virtual bool isTemporary() const { return false; }
+    /** @brief Write count memory blocks into this stream (gather write).
+     *  @details
+     *  The default implementation calls write() for each block. Streams that
+     *  can do better (e.g. write all blocks with one system call) should
+     *  override this method.
+     *  @param iov Array of memory blocks to write.
+     *  @param count Number of blocks in iov.
+     */
+    virtual void writev(const iovec* iov, size_t count)
+    {
+      for (size_t i = 0; i < count; i++)
+        write((const char*) iov[i].iov_base, iov[i].iov_len);
+    }
     template<class T> void put(const T& t)
     {
       write((const char*) &t, sizeof(T));
@@ -117,6 +163,208 @@ namespace tbd
       write((const char*) t, n * sizeof(T));
     }
   };
+  namespace details
+  {
+    template<class SP> __inline const char* borrow(IStream<SP>* pis, size_t size) { return pis->borrow(size); }
+    __inline const char* borrow(const void*, size_t) { return NULL; }
+    template<class SP> __inline const char* window(IStream<SP>* pis, size_t& size) { return pis->window(size); }
+    __inline const char* window(const void*, size_t& size) { size = 0; return NULL; }
+    template<class SP> __inline bool writev(OStream<SP>* pos, const iovec* iov, size_t count) { pos->writev(iov,count); return true; }
+    __inline bool writev(const void*, const iovec*, size_t) { return false; }
+  }
+  /** @brief Borrow the next size bytes of any input stream.
+   *  @details
+   *  Calls IStream::borrow() if I is derived from IStream. For all other
+   *  streams (like std::istream) it returns NULL.
+   *  @ingroup Streams
+   */
+  template<class I> __inline const char* borrow(I& is, size_t size) { return details::borrow(&is,size); }
+  /** @brief Borrow the next size bytes of any input stream or read them into
+   *         a scratch buffer if the stream can't lend them.
+   *  @param is Stream to read from.
+   *  @param size Number of bytes to get.
+   *  @param scratch Buffer that takes the bytes if they can't be borrowed.
+   *  @return Pointer to size bytes or NULL if the stream ran short.
+   *  @ingroup Streams
+   */
+  template<class I> __inline const char* borrow(I& is, size_t size, std::vector<char>& scratch)
+  {
+    const char* p = details::borrow(&is,size);
+    if( NULL != p || 0 == size )
+      return p;
+    scratch.resize(size);
+    is.read(&scratch[0],size);
+    return (size_t)is.gcount() == size ? &scratch[0] : NULL;
+  }
+  /** @brief Returns the contiguous memory at the read position of any input
+   *         stream (see IStream::window()).
+   *  @ingroup Streams
+   */
+  template<class I> __inline const char* window(I& is, size_t& size) { return details::window(&is,size); }
+  /** @brief Write count memory blocks into any output stream.
+   *  @details
+   *  Calls OStream::writev() if O is derived from OStream. For all other
+   *  streams (like std::ostream) every block is written with write().
+   *  @ingroup Streams
+   */
+  template<class O> __inline void writev(O& os, const iovec* iov, size_t count)
+  {
+    if( !details::writev(&os,iov,count) )
+      for( size_t i=0; i<count; i++ )
+        os.write((const char*)iov[i].iov_base,iov[i].iov_len);
+  }
+  /** @brief Fallback for streams that can't copy without user space buffer.
+   *  @details
+   *  Stream implementations provide overloads of this function (found by
+   *  argument dependent lookup) that copy size bytes from the read position
+   *  of is to the write position of os inside the kernel (see filestream.h).
+   *  @return Number of bytes copied (0 if not possible).
+   *  @ingroup Streams
+   */
+  template<class SP> __inline SP nativecopy(const void*, const void*, SP) { return 0; }
+  /** @brief Copies size bytes from the read position of is to the write
+   *         position of os.
+   *  @details
+   *  Tries the cheapest way first: a copy inside the kernel (see
+   *  nativecopy()), a write from memory lent by the input stream (see
+   *  IStream::window()) and finally a copy through buffer.
+   *  @param os Stream to write to.
+   *  @param is Stream to read from.
+   *  @param size Number of bytes to copy.
+   *  @param buffer Buffer to use if needed. It can be reused across calls to
+   *         save allocations. If it's empty a buffer of 1MB is used.
+   *  @return Number of bytes copied (less than size if is ran short).
+   *  @ingroup Streams
+   */
+  template<class O, class I, class SP> SP streamcopy(O& os, I& is, SP size, std::vector<char>& buffer)
+  {
+    SP copied = nativecopy(&os, &is, size);
+    while( copied < size )
+    {
+      size_t n;
+      const char* pch = tbd::window(is, n);
+      if( NULL != pch && 0 < n )
+      {
+        // write directly from the input's memory
+        if( (SP)n > size - copied )
+          n = (size_t)(size - copied);
+        os.write(pch, n);
+        tbd::borrow(is, n);
+      }
+      else
+      {
+        if( buffer.empty() )
+          buffer.resize(1024*1024);
+        n = buffer.size();
+        if( (SP)n > size - copied )
+          n = (size_t)(size - copied);
+        is.read(&buffer[0], n);
+        n = (size_t)is.gcount();
+        if( 0 == n )
+          break;
+        os.write(&buffer[0], n);
+      }
+      copied += (SP)n;
+    }
+    return copied;
+  }
+  /// @brief Copies size bytes from is to os (see streamcopy()).
+  /// @ingroup Streams
+  template<class O, class I, class SP> SP streamcopy(O& os, I& is, SP size)
+  {
+    std::vector<char> buffer;
+    return streamcopy(os, is, size, buffer);
+  }
+  /** @brief Collects many small writes and passes them to an output stream
+   *         in a few gathered writes (see OStream::writev()).
+   *  @details
+   *  Small blocks are copied into an internal scratch buffer where adjacent
+   *  blocks merge into a single memory block. Larger blocks given to
+   *  writeref() are only referenced and must stay valid until flush() has
+   *  been called.
+   *  @attention Nothing reaches the output stream before flush() is called
+   *             or one of the internal buffers is full. The destructor does
+   *             not flush.
+   *  @ingroup Streams
+   */
+  template<class O> class GatherBatch
+  {
+  public:
+    enum
+    {
+      /// @brief Maximum number of memory blocks per gathered write.
+      MAX_BLOCKS = 1024,
+      /// @brief Size of the buffer for copied blocks.
+      SCRATCH_SIZE = 64*1024,
+      /// @brief Blocks given to writeref() up to this size are copied anyway.
+      COPY_LIMIT = 256
+    };
+    /// @brief Constructor
+    /// @param os Stream to write to.
+    explicit GatherBatch(O& os) : m_os(os), m_pBlocks(new iovec[MAX_BLOCKS]), m_unBlocks(0), m_pchScratch(new char[SCRATCH_SIZE]), m_unScratch(0) {}
+    /// @brief Destructor
+    ~GatherBatch() { delete[] m_pBlocks; delete[] m_pchScratch; }
+    /// @brief Copy size bytes from pch into the batch.
+    void write(const char* pch, size_t size)
+    {
+      if( size > SCRATCH_SIZE )
+      {
+        // don't use the scratch buffer for huge blocks
+        flush();
+        m_os.write(pch,size);
+        return;
+      }
+      if( m_unScratch + size > SCRATCH_SIZE || MAX_BLOCKS == m_unBlocks )
+        flush();
+      char* pchDst = m_pchScratch + m_unScratch;
+      ::memcpy(pchDst,pch,size);
+      m_unScratch += size;
+      // extend the last block if it ends where we just copied to
+      if( 0 < m_unBlocks && (char*)m_pBlocks[m_unBlocks-1].iov_base + m_pBlocks[m_unBlocks-1].iov_len == pchDst )
+        m_pBlocks[m_unBlocks-1].iov_len += size;
+      else
+        add(pchDst,size);
+    }
+    /// @brief Put size bytes from pch into the batch without copying them.
+    /// @attention The memory must stay valid until flush() has been called.
+    void writeref(const char* pch, size_t size)
+    {
+      if( size <= COPY_LIMIT )
+        write(pch,size);
+      else
+        add(pch,size);
+    }
+    /// @brief Write all collected blocks into the output stream.
+    void flush()
+    {
+      if( 0 < m_unBlocks )
+        tbd::writev(m_os,m_pBlocks,m_unBlocks);
+      m_unBlocks = m_unScratch = 0;
+    }
+    /// @brief Returns the output stream.
+    O& stream() { return m_os; }
+  private:
+    GatherBatch(const GatherBatch&);
+    GatherBatch& operator=(const GatherBatch&);
+    void add(const char* pch, size_t size)
+    {
+      if( MAX_BLOCKS == m_unBlocks )
+        flush();
+      m_pBlocks[m_unBlocks].iov_base = (void*)pch;
+      m_pBlocks[m_unBlocks].iov_len = size;
+      m_unBlocks++;
+    }
+    /// @brief Stream to write to.
+    O&     m_os;
+    /// @brief Collected memory blocks.
+    iovec* m_pBlocks;
+    /// @brief Number of used entries in m_pBlocks.
+    size_t m_unBlocks;
+    /// @brief Buffer for copied blocks.
+    char*  m_pchScratch;
+    /// @brief Number of used bytes in m_pchScratch.
+    size_t m_unScratch;
+  };
 }
 
 #define IMPLEMENT_OSTREAM_OPERATORS(class_name,streampos) \
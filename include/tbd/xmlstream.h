@@ -6,8 +6,11 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "domstream.h"
+#include "stream.h"
 #include <sstream>
+#include <stack>
 #include <stdlib.h>
+#include <string.h>
 
 #ifndef __TBD__XML_H
 #define __TBD__XML_H
@@ -31,7 +34,7 @@ namespace tbd
   public:
     enum ErrCode
     {
-      Ok, ValueAndElements
+      Ok, ValueAndElements, AttributeAfterElements
     };
     explicit XmlWriteException(ErrCode eErrCode, DomNode* pNode) :
       m_eErrCode(eErrCode), m_strPath(pNode->getPath())
@@ -57,6 +60,9 @@ namespace tbd
       case ValueAndElements:
         ss << "element has value and child elements at '" << getPath();
         break;
+      case AttributeAfterElements:
+        ss << "attribute follows streamed child elements at '" << getPath();
+        break;
       default:
         ss << "(unknown error) at " << getPath();
       }
@@ -172,7 +178,7 @@ namespace tbd
         for (int i = 0; i < nDeepness; i++)
           os << strIndent;
         os << "<" << pNode->getName();
-        bool bOnlyAttributes = pNode->getValueStr().empty();
+        bool bOnlyAttributes = pNode->emptyValue();
         bool bFewAttributes = pNode->attributes() <= nFewAttributes;
         for (DomOStream::iterator it = pNode->begin(); it != pNode->end(); it++)
         {
@@ -191,14 +197,14 @@ namespace tbd
         else
         {
           os << ">";
-          if (pNode->getValueStr().empty())
+          if (pNode->emptyValue())
           {
             os << strLineFeed;
             for (DomOStream::iterator it = pNode->begin(); it != pNode->end(); it++)
             {
               if (!(*it)->isAttribute())
               {
-                BOOST_ASSERT(pNode->getValueStr().empty());
+                BOOST_ASSERT(pNode->emptyValue());
                 write(os, *it, strLineFeed, strIndent, nDeepness + 1, nFewAttributes, bShowHidden);
               }
             }
@@ -238,6 +244,90 @@ namespace tbd
         // write the node into the output stream
         write(os, *it, strLineFeed, strIndent, 0, nFewAttributes, bShowHidden);
     }
+    /** @brief Writes XML in the streaming mode of a DomOStream.
+     *  @details
+     *  The output is the same as of write() except that an element whose
+     *  children elements are all hidden gets a close tag instead of "/>".
+     *  @code
+     *    tbd::xml::Writer<tbd::FileOStream> writer(fos);
+     *    dos.stream(&writer);
+     *    dos << tbd::domopen("data") ...;
+     *    dos.stream(NULL);
+     *  @endcode
+     *  @ingroup XmlStreams
+     */
+    template<class O> class Writer
+      : public DomWriter
+    {
+    public:
+      /** @brief Constructor
+       *  @param os output stream (see write() for the other parameters)
+       */
+      explicit Writer(O& os, const std::string& strLineFeed = "\n", const std::string& strIndent = "  ", unsigned int nFewAttributes = 1, bool bShowHidden = false) :
+        m_os(os), m_strLineFeed(strLineFeed), m_strIndent(strIndent), m_nFewAttributes(nFewAttributes), m_bShowHidden(bShowHidden), m_nHidden(0)
+      {
+      }
+      virtual void begin(DomNode* pNode, int nDeepness)
+      {
+        // nothing below hidden nodes
+        if (0 < m_nHidden || (!m_bShowHidden && pNode->isHidden()) || pNode->isMissing())
+        {
+          m_nHidden++;
+          return;
+        }
+        if (!pNode->emptyValue())
+          TBD_THROW(XmlWriteException(XmlWriteException::ValueAndElements, pNode));
+        for (int i = 0; i < nDeepness; i++)
+          m_os << m_strIndent;
+        m_os << "<" << pNode->getName();
+        // the start tag takes the attributes
+        const unsigned int nAttributes = pNode->attributes();
+        bool bFewAttributes = nAttributes <= m_nFewAttributes;
+        for (DomOStream::iterator it = pNode->begin(); it != pNode->end(); it++)
+        {
+          if (bFewAttributes)
+            write(m_os, *it, " ", "", 0, m_nFewAttributes, m_bShowHidden);
+          else
+            write(m_os, *it, m_strLineFeed, m_strIndent, nDeepness + 1, m_nFewAttributes, m_bShowHidden);
+        }
+        m_os << ">" << m_strLineFeed;
+        m_stckAttributes.push(nAttributes);
+      }
+      virtual void end(DomNode* pNode, int nDeepness, bool bBegun)
+      {
+        if (0 < m_nHidden)
+        {
+          if (bBegun)
+            m_nHidden--;
+          return;
+        }
+        if (!bBegun)
+        {
+          write(m_os, pNode, m_strLineFeed, m_strIndent, nDeepness, m_nFewAttributes, m_bShowHidden);
+          return;
+        }
+        // the start tag has been written already
+        const unsigned int nAttributes = m_stckAttributes.top();
+        m_stckAttributes.pop();
+        if (!pNode->emptyValue())
+          TBD_THROW(XmlWriteException(XmlWriteException::ValueAndElements, pNode));
+        if (pNode->attributes() != nAttributes)
+          TBD_THROW(XmlWriteException(XmlWriteException::AttributeAfterElements, pNode));
+        for (int i = 0; i < nDeepness; i++)
+          m_os << m_strIndent;
+        m_os << "</" << pNode->getName() << ">" << m_strLineFeed;
+      }
+    private:
+      O& m_os;
+      std::string m_strLineFeed;
+      std::string m_strIndent;
+      unsigned int m_nFewAttributes;
+      bool m_bShowHidden;
+      /// @brief Number of begun nodes that are hidden or below hidden ones.
+      int m_nHidden;
+      /// @brief Number of attributes in the start tags of the begun nodes.
+      std::stack<unsigned int> m_stckAttributes;
+    };
     template<class O, class T> void write(O& os, const T& t, const std::string& strLineFeed = "\n", const std::string& strIndent = "  ", unsigned int nFewAttributes = 1, bool bShowHidden = false)
     {
       DomOStream dos;
@@ -255,6 +345,7 @@ namespace tbd
   {
     namespace details
     {
+      template<class I> bool readchild(I& is, DomNode* pNode, const std::string& strWhitespaces, Context& context);
       template<class I> int get(I& is, Context& context)
       {
         int n = is.get();
@@ -267,6 +358,22 @@ namespace tbd
           context.m_unColumn++;
         return n;
       }
+      /// @brief Moves the read position about size bytes that have been looked
+      ///        up in the stream's window p.
+      template<class I> void consume(I& is, const char* p, size_t size, Context& context)
+      {
+        for (const char* pEnd = p + size; p != pEnd; p++)
+        {
+          if ('\n' == *p)
+          {
+            context.m_unLine++;
+            context.m_unColumn = 0;
+          }
+          else
+            context.m_unColumn++;
+        }
+        tbd::borrow(is, size);
+      }
       template<class I> void skip(I& is, const std::string& strWhitespaces, Context& context)
       {
         while (strWhitespaces.find((char) is.peek()) != std::string::npos)
@@ -316,8 +423,20 @@ namespace tbd
           return false;
         get(is,context);
         std::string str;
-        while ('\"' != is.peek())
-          str += (char) get(is,context);
+        // take the value directly from contiguous input
+        size_t size;
+        const char* p = tbd::window(is, size);
+        const char* pEnd = (NULL != p) ? (const char*) memchr(p, '\"', size) : NULL;
+        if (NULL != pEnd)
+        {
+          str.assign(p, pEnd);
+          consume(is, p, pEnd - p, context);
+        }
+        else
+        {
+          while ('\"' != is.peek())
+            str += (char) get(is,context);
+        }
         pNode->setValueStr(str);
         get(is,context);
         return true;
@@ -325,7 +444,22 @@ namespace tbd
       template<class I> bool readvalue(I& is, DomNode* pNode, const std::string& strWhitespaces, Context& context)
       {
         std::string str;
-        for (;;)
+        // take the value directly from contiguous input
+        size_t size;
+        const char* p = tbd::window(is, size);
+        bool bDone = false;
+        for (const char* pLt = p; !bDone && NULL != pLt && NULL != (pLt = (const char*) memchr(pLt, '<', size - (pLt - p))); pLt++)
+        {
+          // stop in front of the close tag
+          if (pLt + 1 < p + size && '/' == pLt[1])
+          {
+            str.assign(p, pLt);
+            consume(is, p, pLt - p, context);
+            bDone = true;
+          }
+        }
+        // slow path for non contiguous input
+        while (!bDone)
         {
           if ('<' == is.peek())
           {
@@ -359,7 +493,7 @@ namespace tbd
           return false;
         default:
           {
-            DomNode *pChild = new DomNode(ATTRIBUTE);
+            DomNode *pChild = pNode->createNode(ATTRIBUTE);
             if (!readname(is, pChild,context))
               TBD_THROW(XmlParseException(XmlParseException::NameExpected, context));
             skip(is, strWhitespaces,context);
@@ -459,10 +593,12 @@ namespace tbd
         if ('/' != is.peek())
         {
           is.unget();
-          DomNode *pChild = new DomNode(OPEN);
+          DomNode *pChild = pNode->createNode(OPEN);
           read(is, pChild, strWhitespaces,context);
           if (!pChild->getName().empty())
             pNode->push_back(pChild);
+          else
+            DomNode::destroy(pChild);
           return true;
         }
         else
@@ -0,0 +1,64 @@
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include "tbd/asyncfilestream.h"
+#include "tbd/filestream.h"
+#include "tbd/stream.h"
+
+using namespace std;
+
+static int _failed = 0;
+
+void check(bool _ok, const char* _what)
+{
+  std::cout << (_ok ? "ok     " : "FAILED ") << _what << std::endl;
+  if (!_ok)
+    _failed++;
+}
+
+const char* _fileName = "asyncfilestream_sample.tmp";
+const char* _copyName = "asyncfilestream_sample2.tmp";
+
+bool readBack(const char* _name, int _count)
+{
+  tbd::FileIStream _is(_name,64*1024);
+  bool _ok = true;
+  for (int i = 0; i < _count && _ok; i++)
+  {
+    int n = -1;
+    _is.get(n);
+    _ok = n == (0 == i ? -1 : i);
+  }
+  return _ok;
+}
+
+int main()
+{
+  const int _count = 1000000;
+  {
+    // small buffers so the writer thread has to keep up
+    tbd::AsyncFileOStream _os(_fileName,false,64*1024,4);
+    check(_os.is_open(), "open()");
+    for (int i = 0; i < _count; i++)
+      _os.put(i);
+    check(_os.tellp() == (tbd::huge_streampos)(_count*sizeof(int)), "tellp()");
+    // patch the first record
+    _os.seekp(0);
+    _os.put(-1);
+    _os.seekp2end();
+    check(_os.sync() && 0 == _os.queued(), "sync() writes everything");
+    check(!_os.fail(), "no failure");
+  }
+  check(readBack(_fileName,_count), "read back");
+  {
+    // streamcopy() into an AsyncFileOStream goes through its buffers
+    tbd::FileIStream _is(_fileName);
+    tbd::AsyncFileOStream _os(_copyName);
+    check(tbd::streamcopy(_os,_is,(tbd::huge_streampos)(_count*sizeof(int))) == (tbd::huge_streampos)(_count*sizeof(int)), "streamcopy()");
+    check(_os.tellp() == (tbd::huge_streampos)(_count*sizeof(int)), "tellp() after streamcopy()");
+  }
+  check(readBack(_copyName,_count), "read back the copy");
+  std::remove(_fileName);
+  std::remove(_copyName);
+  return _failed;
+}
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "tbd/binstream.h"
+
+using namespace std;
+
+static int _failed = 0;
+
+void check(bool _ok, const char* _what)
+{
+  std::cout << (_ok ? "ok     " : "FAILED ") << _what << std::endl;
+  if (!_ok)
+    _failed++;
+}
+
+// output stream that counts the calls it gets
+class CountingOStream : public tbd::OStream<size_t>
+{
+public:
+  CountingOStream() : writes(0), writevs(0) {}
+  void write(const char* pch, size_t size) { writes++; content.append(pch,size); }
+  void writev(const tbd::iovec* iov, size_t count)
+  {
+    writevs++;
+    for (size_t i = 0; i < count; i++)
+      content.append((const char*)iov[i].iov_base,iov[i].iov_len);
+  }
+  void flush() {}
+  size_t tellp() const { return content.size(); }
+  void seekp(const size_t&) {}
+  void seekp2end() {}
+  std::string content;
+  int writes;
+  int writevs;
+};
+
+typedef tbd::BinOStream<unsigned short,unsigned long> BinOStream;
+
+void build(BinOStream& _bos)
+{
+  const std::string _big(1000,'Z');
+  _bos << tbd::domopen("root");
+  for (unsigned long i = 0; i < 10000; i++)
+  {
+    _bos << tbd::domopen("item") << tbd::domopen("value") << i << tbd::domclose();
+    if (i%1000 == 0)
+      _bos << tbd::domopen("value") << _big << tbd::domclose();
+    _bos << tbd::domclose();
+  }
+  _bos << tbd::domclose();
+}
+
+int main()
+{
+  tbd::BinIndex<unsigned short,unsigned long> _index;
+  _index.add(1,"root");
+  _index.add(2,"item");
+  _index.add(3,"value");
+  BinOStream _bos(_index);
+  build(_bos);
+
+  std::cout << "gathered writes" << std::endl;
+  std::ostringstream _ss;
+  const unsigned long _size = _bos.write(_ss);
+  check(_size == _ss.str().size(), "std::ostream gets the whole output");
+  CountingOStream _os;
+  _bos.write(_os);
+  check(_os.content == _ss.str(), "same output through writev()");
+  check(0 == _os.writes && 0 < _os.writevs && _os.writevs < 100, "a few gathered writes only");
+  {
+    tbd::BinIStream<unsigned short,unsigned long> _bis(_index);
+    _bis.read((char*)_os.content.data(),_os.content.size());
+    unsigned long _value = 1;
+    _bis >> tbd::domopen("root") >> tbd::domopen("item") >> tbd::domopen("value") >> _value;
+    check(_bis.getRoot()->size() == 1 && _value == 0, "read back");
+  }
+  std::cout << "exact size" << std::endl;
+  {
+    check(_bos.size() == _size, "size() in advance");
+    char* p = NULL;
+    size_t _written = 0;
+    _bos.write(p,_written);
+    check(_written == _size && 0 == memcmp(p,_ss.str().data(),_written), "write() into a new buffer");
+    delete[] p;
+    std::vector<char> _buffer(_size);
+    check(!_bos.write(&_buffer[0],_size-1,_written) && _written == _size, "buffer too small");
+    check(_bos.write(&_buffer[0],_buffer.size(),_written) && 0 == memcmp(&_buffer[0],_ss.str().data(),_size), "write() into a given buffer");
+  }
+  std::cout << "GatherBatch" << std::endl;
+  {
+    CountingOStream _batched;
+    tbd::GatherBatch<CountingOStream> _batch(_batched);
+    const std::string _big(4096,'x');
+    for (int i = 0; i < 100; i++)
+    {
+      _batch.write("ab",2);
+      _batch.writeref(_big.data(),_big.size());
+    }
+    check(_batched.content.empty(), "nothing written before flush()");
+    _batch.flush();
+    check(_batched.content.size() == 100*(2+_big.size()) && 1 == _batched.writevs, "GatherBatch flushes in one writev()");
+  }
+  return _failed;
+}
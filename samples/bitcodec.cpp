@@ -0,0 +1,100 @@
+#include <iostream>
+#include <vector>
+#include "tbd/bitcodec.h"
+#include "tbd/memstream.h"
+
+using namespace std;
+
+static int _failed = 0;
+
+void check(bool _ok, const char* _what)
+{
+  std::cout << (_ok ? "ok     " : "FAILED ") << _what << std::endl;
+  if (!_ok)
+    _failed++;
+}
+
+// values of all magnitudes
+std::vector<unsigned long long> values()
+{
+  std::vector<unsigned long long> _values;
+  for (unsigned int _bits = 0; _bits <= 64; _bits++)
+    for (unsigned long long i = 0; i < 20; i++)
+      _values.push_back(_bits ? (i*0x9e3779b97f4a7c15ULL) >> (64-_bits) : i);
+  _values.push_back(~0ULL);
+  return _values;
+}
+
+template<typename BITISTREAM>
+bool read(BITISTREAM& _bis, const std::vector<unsigned long long>& _values)
+{
+  bool _ok = true;
+  for (size_t i = 0; i < _values.size() && _ok; i++)
+  {
+    unsigned long long _varint = 0, _expgolomb = 0, _rice = 0;
+    long long _zigzag = 0;
+    _bis >> tbd::varint(_varint) >> tbd::zigzag(_zigzag);
+    _ok = _varint == _values[i] && _zigzag == (long long)_values[i];
+    // long unary codes for large values only with small shifts
+    if (_values[i] < (1ULL << 40))
+    {
+      _bis >> tbd::expgolomb(_expgolomb,2) >> tbd::rice(_rice,30);
+      _ok = _ok && _expgolomb == _values[i] && _rice == _values[i];
+    }
+  }
+  return _ok;
+}
+
+int main()
+{
+  const std::vector<unsigned long long> _values = values();
+  tbd::MemStream<> _ms;
+  {
+    tbd::BitOStream<tbd::MemStream<> > _bos(_ms);
+    for (size_t i = 0; i < _values.size(); i++)
+    {
+      _bos << tbd::varint(_values[i]) << tbd::zigzag((long long)_values[i]);
+      if (_values[i] < (1ULL << 40))
+        _bos << tbd::expgolomb(_values[i],2) << tbd::rice(_values[i],30);
+    }
+    _bos.flush(false);
+  }
+  {
+    tbd::BitIStream<tbd::MemStream<> > _bis(_ms);
+    check(read(_bis,_values), "BitIStream");
+    _bis.align();
+  }
+  {
+    tbd::BitMemIStream<> _bis(_ms.buffer(),_ms.size());
+    check(read(_bis,_values), "BitMemIStream");
+  }
+  {
+    unsigned long long _value = 0;
+    tbd::MemStream<> _small;
+    {
+      tbd::BitOStream<tbd::MemStream<> > _bos(_small);
+      _bos << tbd::varint(300ULL);
+    }
+    check(2 == _small.size() && (unsigned char)_small.buffer()[0] == 0xac && 2 == _small.buffer()[1], "LEB128 layout");
+    tbd::BitMemIStream<> _bis(_small.buffer(),_small.size());
+    _bis >> tbd::varint(_value);
+    check(300 == _value, "LEB128 value");
+  }
+  {
+    // the 10th byte may only carry the highest bit
+    const char _overlong[] = "\xff\xff\xff\xff\xff\xff\xff\xff\xff\x02";
+    tbd::BitMemIStream<> _bis(_overlong,10);
+    bool _thrown = false;
+    try
+    {
+      unsigned long long _value;
+      _bis >> tbd::varint(_value);
+    }
+    catch (tbd::BitParseException& e)
+    {
+      _thrown = tbd::BitParseException::InvalidCode == e.getErrCode();
+    }
+    check(_thrown, "overlong varint rejected");
+  }
+  return _failed;
+}
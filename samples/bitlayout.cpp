@@ -0,0 +1,123 @@
+#include <iostream>
+#include <cstring>
+#include "tbd/bitlayout.h"
+#include "tbd/memstream.h"
+
+using namespace std;
+
+static int _failed = 0;
+
+void check(bool _ok, const char* _what)
+{
+  std::cout << (_ok ? "ok     " : "FAILED ") << _what << std::endl;
+  if (!_ok)
+    _failed++;
+}
+
+enum Type { Data = 1, Ack = 2, Reset = 31 };
+enum class Delta : signed char { Down = -1, Same = 0, Up = 1 };
+
+struct Header
+{
+  unsigned char version;
+  Type type;
+  bool last;
+  unsigned short length;
+  short offset;
+  Delta delta;
+  // spans word boundaries
+  unsigned long long id;
+  long long stamp;
+};
+
+typedef tbd::bit::Layout<
+  TBD_BITFIELD(Header,version,3),
+  TBD_BITFIELD(Header,type,5),
+  TBD_BITFIELD(Header,last,1),
+  TBD_BITFIELD(Header,length,15),
+  TBD_BITFIELD(Header,offset,10),
+  TBD_BITFIELD(Header,delta,2),
+  TBD_BITFIELD(Header,id,64),
+  TBD_BITFIELD(Header,stamp,40) > HeaderLayout;
+
+bool equal(const Header& _a, const Header& _b)
+{
+  return _a.version == _b.version && _a.type == _b.type && _a.last == _b.last && _a.length == _b.length
+    && _a.offset == _b.offset && _a.delta == _b.delta && _a.id == _b.id && _a.stamp == _b.stamp;
+}
+
+// puts each field by hand
+template<typename BITOSTREAM>
+void putFields(BITOSTREAM& _bos, const Header& _h)
+{
+  _bos.put(_h.version,3);
+  _bos.put((unsigned int)_h.type,5);
+  _bos.put(_h.last,1);
+  _bos.put(_h.length,15);
+  _bos.put((unsigned short)_h.offset & 0x3ff,10);
+  _bos.put((unsigned char)_h.delta & 3,2);
+  _bos.put(_h.id,64);
+  _bos.put((unsigned long long)_h.stamp & 0xffffffffffULL,40);
+}
+
+int main()
+{
+  check(HeaderLayout::BITS == 140 && HeaderLayout::BYTES == 18, "BITS and BYTES");
+  Header _headers[3] = {
+    { 5, Data, true, 0x7fff, -512, Delta::Down, ~0ULL, -1 },
+    { 0, Reset, false, 1234, 511, Delta::Up, 0x0123456789abcdefULL, -549755813888LL },
+    { 7, Ack, true, 0, -1, Delta::Same, 1, 549755813887LL } };
+  tbd::MemStream<> _layout, _manual;
+  {
+    tbd::BitOStream<tbd::MemStream<> > _bos(_layout), _bosManual(_manual);
+    for (int i = 0; i < 3; i++)
+    {
+      HeaderLayout::put(_bos,_headers[i]);
+      putFields(_bosManual,_headers[i]);
+    }
+    _bos.flush(false);
+    _bosManual.flush(false);
+  }
+  check(_layout.size() == _manual.size() && 0 == memcmp(_layout.buffer(),_manual.buffer(),_layout.size()), "same bits as put() of each field");
+  {
+    tbd::BitIStream<tbd::MemStream<> > _bis(_layout);
+    bool _ok = true;
+    for (int i = 0; i < 3; i++)
+    {
+      Header _h;
+      HeaderLayout::get(_bis,_h);
+      _ok = _ok && equal(_h,_headers[i]);
+    }
+    _bis.align();
+    check(_ok, "get() with BitIStream");
+  }
+  {
+    tbd::BitMemIStream<> _bis(_layout.buffer(),_layout.size());
+    bool _ok = true;
+    for (int i = 0; i < 3; i++)
+    {
+      Header _h;
+      HeaderLayout::get(_bis,_h);
+      _ok = _ok && equal(_h,_headers[i]);
+    }
+    check(_ok, "get() with BitMemIStream");
+  }
+  {
+    char _ach[HeaderLayout::BYTES];
+    memset(_ach,0x55,sizeof(_ach));
+    HeaderLayout::pack(_ach,_headers[0]);
+    tbd::MemStream<> _single;
+    {
+      tbd::BitOStream<tbd::MemStream<> > _bos(_single);
+      putFields(_bos,_headers[0]);
+      _bos.flush(false);
+    }
+    check(_single.size() == sizeof(_ach) && 0 == memcmp(_ach,_single.buffer(),sizeof(_ach)), "pack() with cleared padding");
+    Header _h;
+    HeaderLayout::unpack(_ach,_h);
+    check(equal(_h,_headers[0]), "unpack()");
+    check(_h.offset == -512 && _h.stamp == -1, "signed members sign extended");
+    check(_h.delta == Delta::Down, "signed enum sign extended");
+  }
+  return _failed;
+}
@@ -0,0 +1,204 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include "tbd/bitstream.h"
+#include "tbd/memstream.h"
+
+using namespace std;
+
+static int _failed = 0;
+
+void check(bool _ok, const char* _what)
+{
+  std::cout << (_ok ? "ok     " : "FAILED ") << _what << std::endl;
+  if (!_ok)
+    _failed++;
+}
+
+// the bit cache reads ahead, the source stream gets the bytes back
+template<typename ISTREAM>
+void readAhead(ISTREAM& _is, const char* _name)
+{
+  std::cout << _name << std::endl;
+  {
+    tbd::BitIStream<ISTREAM> _bis(_is);
+    unsigned short _u = 0;
+    _bis.get(_u,12);
+    check(_u == 0x414, "get 12 bits");
+    _bis.align();
+    check(_bis.tellg() == 16, "aligned to 2 bytes");
+    check(_is.tellg() > 2, "source stream read ahead");
+    // gives the bytes back
+    check(_bis.istream().tellg() == 2, "istream() gives the bytes back");
+    unsigned char _uch = 0;
+    _bis.get(_uch,8);
+    check(_uch == 'C', "get next byte");
+  }
+  check(_is.tellg() == 3, "destructor gives the bytes back");
+  check(!_is.fail(), "source stream not failed");
+}
+
+// fields of every width through the 64 bit cache
+void roundTrip()
+{
+  std::cout << "round trip" << std::endl;
+  tbd::MemStream<> _ms;
+  {
+    tbd::BitOStream<tbd::MemStream<> > _bos(_ms);
+    for (unsigned int i = 0; i < 10000; i++)
+    {
+      const unsigned int _bits = 1+i%64;
+      const unsigned long long _value = (i*0x9e3779b97f4a7c15ULL) >> (64-_bits);
+      _bos.put(_value,_bits);
+    }
+    _bos.flush(false);
+  }
+  size_t _bits = 0;
+  for (unsigned int i = 0; i < 10000; i++)
+    _bits += 1+i%64;
+  check(_ms.size() == (_bits+7)/8, "size of the output");
+  tbd::BitIStream<tbd::MemStream<> > _bis(_ms);
+  bool _ok = true;
+  for (unsigned int i = 0; i < 10000 && _ok; i++)
+  {
+    const unsigned int _width = 1+i%64;
+    unsigned long long _value = 0;
+    _bis.get(_value,_width);
+    _ok = _value == (i*0x9e3779b97f4a7c15ULL) >> (64-_width);
+  }
+  check(_ok, "read back");
+  // the destructor expects an aligned stream
+  _bis.align();
+
+  std::cout << "BitMemIStream" << std::endl;
+  tbd::BitMemIStream<> _bmis(_ms.buffer(),_ms.size());
+  _ok = true;
+  for (unsigned int i = 0; i < 10000 && _ok; i++)
+  {
+    const unsigned int _width = 1+i%64;
+    unsigned long long _value = 0;
+    if (i%3)
+      _bmis.get(_value,_width);
+    else
+    {
+      // peek and skip instead
+      _bmis.peek(_value,_width);
+      _bmis.skip(_width);
+    }
+    _ok = _value == (i*0x9e3779b97f4a7c15ULL) >> (64-_width);
+  }
+  check(_ok, "read from memory");
+  check(_bmis.tellg() == (tbd::BitStream::streampos)_bits, "tellg()");
+  _bmis.seekg(1+2+3);
+  unsigned char _uch = 0;
+  _bmis.get(_uch,4);
+  check(_uch == (3*0x9e3779b97f4a7c15ULL) >> 60, "seekg()");
+  _bmis.seekg2end();
+  bool _thrown = false;
+  try
+  {
+    _bmis.get(_uch,8);
+  }
+  catch (tbd::BitParseException&)
+  {
+    _thrown = true;
+  }
+  check(_thrown && _bmis.fail(), "reading past the end throws");
+}
+
+// arrays converted into network byte order at once
+template<typename T>
+bool arrays(unsigned int _offset)
+{
+  std::vector<T> _items(1001);
+  for (size_t i = 0; i < _items.size(); i++)
+    _items[i] = (T)(i*0x9e3779b97f4a7c15ULL);
+  std::vector<T> _swapped(_items.size());
+  tbd::host2net(&_swapped[0],&_items[0],_items.size());
+  bool _ok = true;
+  for (size_t i = 0; i < _items.size() && _ok; i++)
+    _ok = _swapped[i] == tbd::host2net(_items[i]);
+  tbd::MemStream<> _ms;
+  {
+    tbd::BitOStream<tbd::MemStream<> > _bos(_ms);
+    if (_offset)
+      _bos.put(0U,_offset);
+    _bos.putn(&_items[0],_items.size());
+    _bos.flush(false);
+  }
+  tbd::BitIStream<tbd::MemStream<> > _bis(_ms);
+  if (_offset)
+    _bis.skip(_offset);
+  std::vector<T> _read(_items.size());
+  _bis.getn(&_read[0],_read.size());
+  _bis.align();
+  return _ok && _read == _items;
+}
+
+// N bit integers packed and unpacked in bulk
+template<typename T>
+bool packed(unsigned int _bits, unsigned int _offset)
+{
+  std::vector<T> _items(1003);
+  for (size_t i = 0; i < _items.size(); i++)
+  {
+    // values that fit into _bits (sign extended for signed types)
+    const unsigned long long _value = (i*0x9e3779b97f4a7c15ULL) >> (64-_bits);
+    _items[i] = (T)(_value << (sizeof(T)*8-_bits)) >> (sizeof(T)*8-_bits);
+  }
+  tbd::MemStream<> _ms;
+  {
+    tbd::BitOStream<tbd::MemStream<> > _bos(_ms);
+    if (_offset)
+      _bos.put(0U,_offset);
+    _bos.putBits(&_items[0],_items.size(),_bits);
+    _bos.flush(false);
+  }
+  if (_ms.size() != (_offset+_items.size()*_bits+7)/8)
+    return false;
+  std::vector<T> _read(_items.size());
+  {
+    tbd::BitIStream<tbd::MemStream<> > _bis(_ms);
+    if (_offset)
+      _bis.skip(_offset);
+    _bis.getBits(&_read[0],_read.size(),_bits);
+    _bis.align();
+  }
+  if (_read != _items)
+    return false;
+  tbd::BitMemIStream<> _bmis(_ms.buffer(),_ms.size());
+  if (_offset)
+    _bmis.skip(_offset);
+  std::fill(_read.begin(),_read.end(),T());
+  _bmis.getBits(&_read[0],_read.size(),_bits);
+  return _read == _items;
+}
+
+int main()
+{
+  const std::string _content = "ABCDEFGH";
+  {
+    std::istringstream _is(_content);
+    readAhead(_is,"std::istringstream");
+  }
+  {
+    tbd::MemIStream<> _is(_content.data(),_content.size());
+    readAhead(_is,"tbd::MemIStream");
+  }
+  roundTrip();
+  std::cout << "arrays" << std::endl;
+  check(arrays<unsigned short>(0) && arrays<unsigned short>(3), "16 bit");
+  check(arrays<unsigned int>(0) && arrays<unsigned int>(5), "32 bit");
+  check(arrays<unsigned long long>(0) && arrays<unsigned long long>(7), "64 bit");
+  std::cout << "putBits and getBits" << std::endl;
+  bool _ok = true;
+  for (unsigned int _bits = 1; _bits <= 32; _bits++)
+    _ok = _ok && packed<unsigned int>(_bits,0) && packed<unsigned int>(_bits,5) && packed<int>(_bits,3);
+  check(_ok, "1 to 32 bits");
+  _ok = true;
+  for (unsigned int _bits = 33; _bits <= 64; _bits++)
+    _ok = _ok && packed<unsigned long long>(_bits,0) && packed<long long>(_bits,1);
+  check(_ok, "33 to 64 bits");
+  return _failed;
+}
@@ -0,0 +1,108 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "tbd/bitstream.h"
+#include "tbd/memstream.h"
+#include "tbd/bitcodec.h"
+
+using namespace std;
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds(const Clock::time_point& _start)
+{
+  return std::chrono::duration<double>(Clock::now()-_start).count();
+}
+
+template<typename FUNCTOR>
+double best(FUNCTOR f)
+{
+  double _best = 1e30;
+  for (int _run = 0; _run < 5; _run++)
+  {
+    auto _start = Clock::now();
+    f();
+    _best = std::min(_best,seconds(_start));
+  }
+  return _best;
+}
+
+void report(const char* _what, double _old, double _new)
+{
+  std::cout << _what << ": " << _old << "s -> " << _new << "s (" << _old/_new << "x)" << std::endl;
+}
+
+// 12 bit fields through BitIStream over a MemIStream and through BitMemIStream
+bool fields12(const std::vector<char>& _content, size_t _count)
+{
+  unsigned long long _sumStream = 0, _sumMem = 0;
+  double _stream = best([&]()
+  {
+    tbd::MemIStream<> _is(&_content[0],_content.size());
+    tbd::BitIStream<tbd::MemIStream<> > _bis(_is);
+    for (size_t i = 0; i < _count; i++)
+    {
+      unsigned short _u = 0;
+      _bis.get(_u,12);
+      _sumStream += _u;
+    }
+  });
+  double _mem = best([&]()
+  {
+    tbd::BitMemIStream<> _bis(&_content[0],_content.size());
+    for (size_t i = 0; i < _count; i++)
+    {
+      unsigned short _u = 0;
+      _bis.get(_u,12);
+      _sumMem += _u;
+    }
+  });
+  report("12 bit fields BitIStream<MemIStream> -> BitMemIStream",_stream,_mem);
+  return _sumStream == _sumMem;
+}
+
+// 1-5 byte varints byte by byte and from one lookahead() of BitMemIStream
+bool varints(size_t _count)
+{
+  tbd::MemStream<> _ms;
+  {
+    tbd::BitOStream<tbd::MemStream<> > _bos(_ms);
+    for (size_t i = 0; i < _count; i++)
+      _bos << tbd::varint((unsigned long long)rand() >> (rand()%31));
+  }
+  unsigned long long _sumLoop = 0, _sumLookahead = 0;
+  double _loop = best([&]()
+  {
+    tbd::BitMemIStream<> _bis(_ms.buffer(),_ms.size());
+    for (size_t i = 0; i < _count; i++)
+      _sumLoop += tbd::bitcodec::getVarint<tbd::BitMemIStream<> >(_bis);
+  });
+  double _lookahead = best([&]()
+  {
+    tbd::BitMemIStream<> _bis(_ms.buffer(),_ms.size());
+    for (size_t i = 0; i < _count; i++)
+    {
+      unsigned long long _ull;
+      _bis >> tbd::varint(_ull);
+      _sumLookahead += _ull;
+    }
+  });
+  report("varints byte loop -> lookahead",_loop,_lookahead);
+  return _sumLoop == _sumLookahead;
+}
+
+int main()
+{
+  const size_t _count = 4000000;
+  std::vector<char> _content(_count*12/8+8);
+  srand(1);
+  for (auto& _ch : _content)
+    _ch = (char)rand();
+  if (!fields12(_content,_count) || !varints(_count/2))
+  {
+    std::cout << "FAILED: different results" << std::endl;
+    return 1;
+  }
+  return 0;
+}
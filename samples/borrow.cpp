@@ -0,0 +1,67 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cstring>
+#include "tbd/memstream.h"
+#include "tbd/binstream.h"
+#include "tbd/xmlstream.h"
+
+using namespace std;
+
+static int _failed = 0;
+
+void check(bool _ok, const char* _what)
+{
+  std::cout << (_ok ? "ok     " : "FAILED ") << _what << std::endl;
+  if (!_ok)
+    _failed++;
+}
+
+typedef tbd::BinNode<unsigned short,unsigned short> Node;
+
+int main()
+{
+  std::cout << "borrow and window" << std::endl;
+  {
+    const char _buffer[] = "abcdefgh";
+    tbd::MemIStream<> _is(_buffer,8);
+    size_t n = 0;
+    check(tbd::window(_is,n) == _buffer && n == 8, "window() of a MemIStream");
+    check(_is.tellg() == 0, "window() doesn't move");
+    check(tbd::borrow(_is,3) == _buffer && _is.tellg() == 3, "borrow() lends and moves");
+    check(tbd::borrow(_is,6) == NULL && _is.tellg() == 3, "borrow() beyond the end");
+  }
+  {
+    std::istringstream _is("xyz");
+    size_t n = 1;
+    check(tbd::window(_is,n) == NULL && n == 0, "no window() of a std::istream");
+    check(tbd::borrow(_is,2) == NULL, "no borrow() from a std::istream");
+    std::vector<char> _scratch;
+    const char* p = tbd::borrow(_is,2,_scratch);
+    check(p != NULL && 0 == memcmp(p,"xy",2), "borrow() into a scratch buffer");
+  }
+  std::cout << "zero copy BinIStream" << std::endl;
+  {
+    tbd::BinIndex<unsigned short,unsigned short> _index;
+    _index.add(1,"a");
+    _index.add(2,"b");
+    // b { a:"xyz" }
+    char _buffer[] = { (char)0x80,2,0,7, 0,1,0,3,'x','y','z' };
+    tbd::Bin16IStream _bis(_index);
+    _bis.zerocopy(true);
+    _bis.read(_buffer,sizeof(_buffer));
+    Node* a = (Node*)(*(Node*)(*(Node*)_bis.getRoot())[0])[0];
+    check(a->isBufferRef() && a->getBuffer() == _buffer+8, "leaf refers to the input");
+  }
+  std::cout << "XML from memory" << std::endl;
+  {
+    const std::string _xml = "<root>\n <a v=\"q1\">hello < w</a>\n <b>x</b></root>";
+    tbd::MemIStream<> _is(_xml.data(),_xml.size());
+    tbd::DomIStream _dis;
+    tbd::xml::read(_is,_dis);
+    std::string _value;
+    _dis >> tbd::domopen("root") >> tbd::domopen("a") >> _value;
+    check(_value == "hello < w", "element value scanned in the window");
+  }
+  return _failed;
+}
@@ -0,0 +1,297 @@
+#include <iostream>
+#include <clocale>
+#include <climits>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "tbd/xmlstream.h"
+#include "tbd/binstream.h"
+#include "tbd/memstream.h"
+
+using namespace std;
+
+static int _failed = 0;
+
+void check(bool _ok, const char* _what)
+{
+  std::cout << (_ok ? "ok     " : "FAILED ") << _what << std::endl;
+  if (!_ok)
+    _failed++;
+}
+
+// attributes are closed by the next command
+void build(tbd::DomOStream& _dos, int _items)
+{
+  _dos << tbd::domopen("doc") << tbd::domattr("version") << 2;
+  for (int i = 0; i < _items; i++)
+    _dos << tbd::domopen("item") << tbd::domattr("id") << i
+      << tbd::domopen("name") << "item" + std::to_string(i) << tbd::domclose()
+      << tbd::domclose();
+  _dos << tbd::domclose();
+}
+
+std::string xml(tbd::DomOStream& _dos)
+{
+  tbd::MemOStream<size_t> _ms;
+  tbd::xml::write(_ms,_dos);
+  return std::string(_ms.buffer(),_ms.size());
+}
+
+// documents built and read in a DomArena
+void arena()
+{
+  std::cout << "arena" << std::endl;
+  std::string _heap;
+  {
+    tbd::DomOStream _dos;
+    build(_dos,1000);
+    _heap = xml(_dos);
+  }
+  tbd::DomOStream _dos;
+  check(!_dos.arena(true) && _dos.arena(), "arena(true)");
+  build(_dos,1000);
+  const tbd::DomArena* _arena = _dos.getRoot()->arena();
+  check(NULL != _arena && 0 < _arena->bytes() && 0 < _arena->blocks(), "nodes allocated in the arena");
+  check(xml(_dos) == _heap, "same XML as without arena");
+  {
+    tbd::MemIStream<size_t> _ms(_heap.data(),_heap.size());
+    tbd::DomIStream _dis;
+    _dis.arena(true);
+    tbd::xml::read(_ms,_dis);
+    int _id = -1;
+    std::string _name;
+    _dis >> tbd::domopen("doc") >> tbd::domopen("item") >> tbd::domattr("id") >> _id
+      >> tbd::domopen("name") >> _name >> tbd::domclose() >> tbd::domclose() >> tbd::domclose();
+    check(_dis.getRoot()->arena() && 0 == _id && _name == "item0", "read XML into an arena");
+  }
+  // the root owns the arena, the whole document goes with it
+  delete _dos.detach();
+}
+
+typedef tbd::BinIndex<unsigned short,unsigned int> BinIndex;
+
+// IDs of the names that build() uses
+void names(BinIndex& _index)
+{
+  _index.add(1,"doc");
+  _index.add(2,"version");
+  _index.add(3,"item");
+  _index.add(4,"id");
+  _index.add(5,"name");
+}
+
+// binary output with the IDs of the names
+std::string binary(bool _arena)
+{
+  BinIndex _index;
+  names(_index);
+  tbd::BinOStream<unsigned short,unsigned int> _bos(_index);
+  _bos.arena(_arena);
+  build(_bos,100);
+  std::ostringstream _ss;
+  _bos.write(_ss);
+  return _ss.str();
+}
+
+// names interned as symbols
+void symbols()
+{
+  std::cout << "symbols" << std::endl;
+  tbd::DomSymbols& _global = tbd::DomSymbols::global();
+  const tbd::DomSymbol _item = _global.intern("item");
+  check(_item == _global.intern(std::string("it")+"em") && _item.name() == "item" && _item.symbols() == &_global, "intern() returns the same symbol");
+  check(_global.symbol(_item.id()) == _item, "symbol() by id");
+  tbd::DomSymbol _unknown;
+  check(!_global.find("never used as a name",_unknown) && _unknown.empty(), "find() doesn't add names");
+  {
+    tbd::DomOStream _dos;
+    build(_dos,10);
+    tbd::DomNode* _doc = *_dos.getRoot()->find("doc");
+    check((*_doc->find(_item))->getSymbol() == _item, "nodes without arena use the global table");
+    check(_doc->find("never used as a name") == _doc->end(), "unknown names aren't found");
+  }
+  tbd::DomOStream _dos;
+  _dos.arena(true);
+  build(_dos,10);
+  tbd::DomNode* _doc = *_dos.getRoot()->find("doc");
+  tbd::DomSymbols& _symbols = _doc->symbols();
+  check(&_symbols == &_dos.getRoot()->arena()->symbols() && &_symbols != &_global, "arena documents have their own table");
+  tbd::DomNode::iterator _it = _doc->find(_item);
+  check(_it != _doc->end() && (*_it)->getSymbol().symbols() == &_symbols, "found with a symbol of the global table");
+  (*_it)->setSymbol(_global.intern("renamed"));
+  check((*_it)->getSymbol().symbols() == &_symbols && (*_it)->getName() == "renamed", "setSymbol() interns into the own table");
+  check(binary(true) == binary(false), "same binary output in an arena");
+}
+
+// children of large nodes looked up by an index
+void index()
+{
+  std::cout << "index" << std::endl;
+  // above the threshold and a multiple of 3
+  const int _children = 9*tbd::DomNode::INDEX_THRESHOLD;
+  const char* _names[] = { "a", "b", "c" };
+  tbd::DomOStream _dos;
+  _dos << tbd::domopen("doc");
+  for (int i = 0; i < _children; i++)
+    _dos << tbd::domopen(_names[i%3]) << i << tbd::domclose();
+  _dos << tbd::domclose();
+  tbd::DomNode* _doc = *_dos.getRoot()->find("doc");
+  // all "b" in order with find(name,it)
+  bool _ok = true;
+  int _count = 0;
+  for (tbd::DomNode::iterator it = _doc->begin(); it != _doc->end() && _ok; it++)
+  {
+    tbd::DomNode::iterator _found = _doc->find("b",it);
+    if (_found == _doc->end())
+      break;
+    int n = -1;
+    (*_found)->get(n);
+    _ok = n == 1+3*_count++;
+  }
+  check(_ok && _count == _children/3, "find() of every child with a name");
+  tbd::DomNode* _new = _doc->createNode(tbd::domopen("d"));
+  _doc->push_back(_new);
+  check(_doc->find("d") != _doc->end() && *_doc->find("d") == _new, "index follows push_back()");
+  _doc->erase(*_doc->find("a"));
+  int n = -1;
+  (*_doc->find("a"))->get(n);
+  check(n == 3, "index follows erase()");
+  (*_doc->find("c"))->setName("a");
+  (*_doc->find("a"))->get(n);
+  check(n == 2, "index follows setName()");
+  tbd::DomIStream _dis(_dos.detach());
+  std::vector<int> _bs;
+  _dis >> tbd::domopen("doc") >> tbd::domopen("b") >> _bs >> tbd::domclose() >> tbd::domclose();
+  check(_bs.size() == (size_t)_children/3 && _bs.back() == _children-2, "read a sequence");
+}
+
+template<typename T>
+std::string text(const T& _value)
+{
+  tbd::DomNode _node(tbd::domopen("value"));
+  _node.set(_value);
+  return _node.getValueStr();
+}
+
+template<typename T>
+T parsed(const std::string& _text)
+{
+  tbd::DomNode _node(tbd::domopen("value"));
+  _node.setValueStr(_text);
+  T _value = T();
+  _node.get(_value);
+  return _value;
+}
+
+// nodes written as soon as they are closed
+void streaming()
+{
+  std::cout << "streaming" << std::endl;
+  std::string _tree;
+  {
+    tbd::DomOStream _dos;
+    build(_dos,1000);
+    _tree = xml(_dos);
+  }
+  {
+    tbd::MemOStream<size_t> _ms;
+    tbd::xml::Writer<tbd::MemOStream<size_t> > _writer(_ms);
+    tbd::DomOStream _dos;
+    _dos.stream(&_writer);
+    build(_dos,1000);
+    _dos.stream(NULL);
+    check(_dos.getRoot()->empty(), "closed nodes removed");
+    check(std::string(_ms.buffer(),_ms.size()) == _tree, "same XML as written from the tree");
+  }
+  BinIndex _index;
+  names(_index);
+  std::ostringstream _ss;
+  {
+    tbd::BinOStream<unsigned short,unsigned int> _bos(_index);
+    build(_bos,1000);
+    _bos.write(_ss);
+  }
+  tbd::MemOStream<size_t> _ms;
+  tbd::BinOStream<unsigned short,unsigned int> _bos(_index);
+  _bos.stream(_ms);
+  build(_bos,1000);
+  _bos.stream(NULL);
+  check(_bos.getRoot()->empty(), "closed binary nodes removed");
+  check(std::string(_ms.buffer(),_ms.size()) == _ss.str(), "same binary output as written from the tree");
+}
+
+// typed values formatted and parsed in the classic locale
+void values()
+{
+  {
+    tbd::DomNode _node(tbd::domopen("value"));
+    _node.set(-42);
+    double d = 0;
+    _node.get(d);
+    check(tbd::DomNode::INT_VALUE == _node.getValueType() && "-42" == _node.getValueStr() && -42 == d, "typed integer");
+  }
+  check(text(LLONG_MIN) == "-9223372036854775808" && parsed<long long>(text(LLONG_MIN)) == LLONG_MIN, "LLONG_MIN");
+  check(text(ULLONG_MAX) == "18446744073709551615" && parsed<unsigned long long>(text(ULLONG_MAX)) == ULLONG_MAX, "ULLONG_MAX");
+  check(parsed<long long>(" 99999999999999999999") == LLONG_MAX && parsed<long long>("-99999999999999999999") == LLONG_MIN, "saturated");
+  check(text(true) == "1" && parsed<bool>("1"), "bool");
+  check(text(3.5) == "3.5" && parsed<double>("3.5") == 3.5, "3.5");
+  check(text(-0.25) == "-0.25" && text(1e300) == "1e+300" && parsed<double>("1e+300") == 1e300, "fractions and exponents");
+  const double _inf = std::numeric_limits<double>::infinity();
+  check(text(_inf) == "inf" && parsed<double>("inf") == _inf && parsed<double>("-inf") == -_inf, "infinity");
+  tbd::DomOStream _dos;
+  _dos << tbd::domopen("doc") << tbd::domattr("f") << 0.125
+    << tbd::domopen("d") << 3.5 << tbd::domclose() << tbd::domclose();
+  const std::string _xml = xml(_dos);
+  check(std::string::npos != _xml.find("f=\"0.125\"") && std::string::npos != _xml.find("<d>3.5</d>"), "XML with decimal points");
+  tbd::MemIStream<size_t> _ms(_xml.data(),_xml.size());
+  tbd::DomIStream _dis;
+  tbd::xml::read(_ms,_dis);
+  double _f = 0, _d = 0;
+  _dis >> tbd::domopen("doc") >> tbd::domattr("f") >> _f >> tbd::domopen("d") >> _d >> tbd::domclose() >> tbd::domclose();
+  check(0.125 == _f && 3.5 == _d, "XML read back");
+}
+
+// switches to a locale with a decimal comma if there is one
+bool commaLocale()
+{
+  const char* _names[] = { "de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "German_Germany.1252", "" };
+  for (size_t i = 0; i < sizeof(_names)/sizeof(_names[0]); i++)
+  {
+    try
+    {
+      std::locale::global(std::locale(_names[i]));
+    }
+    catch (std::runtime_error&)
+    {
+      continue;
+    }
+    if (',' == *localeconv()->decimal_point)
+    {
+      std::cout << "locale " << std::locale().name() << std::endl;
+      return true;
+    }
+  }
+  std::locale::global(std::locale::classic());
+  return false;
+}
+
+int main()
+{
+  arena();
+  symbols();
+  index();
+  streaming();
+  std::cout << "values" << std::endl;
+  values();
+  // setlocale() doesn't change the text of the values
+  if (commaLocale())
+  {
+    values();
+    std::locale::global(std::locale::classic());
+  }
+  else
+    std::cout << "       no locale with a decimal comma, skipped" << std::endl;
+  return _failed;
+}
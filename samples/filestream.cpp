@@ -0,0 +1,161 @@
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <boost/thread.hpp>
+#include "tbd/filestream.h"
+
+using namespace std;
+
+static int _failed = 0;
+
+void check(bool _ok, const char* _what)
+{
+  std::cout << (_ok ? "ok     " : "FAILED ") << _what << std::endl;
+  if (!_ok)
+    _failed++;
+}
+
+const char* _fileName = "filestream_sample.tmp";
+
+// many small reads and writes through the user space buffer
+void buffered()
+{
+  std::cout << "buffered mode" << std::endl;
+  {
+    tbd::FileOStream _os(_fileName,false,4096);
+    check(_os.getBufferSize() == 4096, "write buffer size");
+    for (int i = 0; i < 10000; i++)
+      _os.put(i);
+    check(_os.tellp() == 10000*sizeof(int), "tellp() counts buffered bytes");
+  }
+  tbd::FileIStream _is(_fileName,4096);
+  bool _ok = true;
+  for (int i = 0; i < 10000 && _ok; i++)
+  {
+    int n = -1;
+    _is.get(n);
+    _ok = n == i;
+  }
+  check(_ok, "read back");
+  _is.seekg(4*sizeof(int));
+  int n = -1;
+  _is.get(n);
+  check(n == 4, "seek inside the buffer");
+  check(_is.peek() == 5, "peek()");
+  _is.seekg2end();
+  _is.get(n);
+  check(_is.fail(), "read at the end fails");
+}
+
+// flush() after every record with each durability mode
+void durability(tbd::FileStreamBase::Durability _durability, const char* _name)
+{
+  std::cout << _name << std::endl;
+  auto _start = std::chrono::steady_clock::now();
+  {
+    tbd::FileOStream _os(_fileName);
+    _os.setDurability(_durability,64*1024,100);
+    check(_os.getDurability() == _durability, "getDurability()");
+    for (int i = 0; i < 200; i++)
+    {
+      _os.put(i);
+      _os.flush();
+    }
+  }
+  std::cout << "       " << std::chrono::duration<double>(std::chrono::steady_clock::now()-_start).count() << "s" << std::endl;
+  tbd::FileIStream _is(_fileName);
+  int n = -1;
+  _is.seekg(199*sizeof(int));
+  _is.get(n);
+  check(n == 199, "everything written");
+}
+
+#if !defined(_WIN32)
+// FileCursors reading regions of one file concurrently
+void positional()
+{
+  std::cout << "positional mode" << std::endl;
+  const int _count = 100000;
+  tbd::FileStream _fs;
+  _fs.open(_fileName,tbd::FileStreamBase::OM_RWCREATE);
+  check(_fs.setPositional(true) && _fs.isPositional(), "setPositional()");
+  for (int i = 0; i < _count; i++)
+    _fs.put(i);
+  check(_fs.tellp() == (tbd::huge_streampos)(_count*sizeof(int)), "tellp()");
+  _fs.seekg(sizeof(int));
+  int n = -1;
+  _fs.get(n);
+  check(n == 1, "read with pread()");
+  const int _threads = 4;
+  std::vector<bool> _ok(_threads,false);
+  boost::thread_group _group;
+  for (int t = 0; t < _threads; t++)
+    _group.create_thread([&_fs,&_ok,t,_count,_threads]()
+    {
+      const int _first = t*_count/_threads;
+      tbd::FileCursor _cursor(_fs,_first*sizeof(int),4096);
+      bool _same = true;
+      for (int i = _first; i < (t+1)*_count/_threads && _same; i++)
+      {
+        int n = -1;
+        _cursor.get(n);
+        _same = n == i;
+      }
+      _ok[t] = _same;
+    });
+  _group.join_all();
+  check(_ok == std::vector<bool>(_threads,true), "concurrent FileCursors");
+  check(_fs.tellg() == 2*sizeof(int), "file position untouched by the cursors");
+}
+#endif
+
+// file to file copies inside the kernel
+void copy()
+{
+  std::cout << "streamcopy" << std::endl;
+  const char* _copyName = "filestream_sample2.tmp";
+  {
+    tbd::FileOStream _os(_fileName);
+    for (int i = 0; i < 100000; i++)
+      _os.put(i);
+  }
+  {
+    tbd::FileIStream _is(_fileName);
+    tbd::FileOStream _os(_copyName);
+    _is.seekg(sizeof(int));
+    const tbd::huge_streampos _size = 1000*sizeof(int);
+    check(tbd::streamcopy(_os,_is,_size) == _size, "streamcopy()");
+    check(_is.tellg() == _size+sizeof(int) && _os.tellp() == _size, "positions behind the copy");
+    check(tbd::streamcopy(_os,_is,(tbd::huge_streampos)(1000000*sizeof(int))) == (tbd::huge_streampos)(99999-1000)*sizeof(int), "copy stops at the end");
+  }
+  {
+    tbd::FileIStream _is(_copyName);
+    bool _ok = true;
+    for (int i = 1; i < 100000 && _ok; i++)
+    {
+      int n = -1;
+      _is.get(n);
+      _ok = n == i;
+    }
+    check(_ok, "read the copy");
+  }
+  std::remove(_copyName);
+}
+
+int main()
+{
+  buffered();
+  durability(tbd::FileStreamBase::DM_FSYNC,"fsync on flush()");
+  durability(tbd::FileStreamBase::DM_FDATASYNC,"fdatasync on flush()");
+  durability(tbd::FileStreamBase::DM_PERIODIC,"periodic");
+  durability(tbd::FileStreamBase::DM_ON_CLOSE,"on close");
+  durability(tbd::FileStreamBase::DM_NONE,"never");
+#if !defined(_WIN32)
+  positional();
+#endif
+  copy();
+  std::remove(_fileName);
+  return _failed;
+}
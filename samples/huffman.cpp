@@ -0,0 +1,76 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "tbd/huffman.h"
+#include "tbd/memstream.h"
+
+using namespace std;
+
+static int _failed = 0;
+
+void check(bool _ok, const char* _what)
+{
+  std::cout << (_ok ? "ok     " : "FAILED ") << _what << std::endl;
+  if (!_ok)
+    _failed++;
+}
+
+// compresses text and decodes it with BitIStream and BitMemIStream
+void text(unsigned int _maxLength)
+{
+  std::cout << "max length " << _maxLength << std::endl;
+  std::string _text;
+  for (int i = 0; i < 2000; i++)
+    _text += "the quick brown fox jumps over the lazy dog " + std::to_string(i*i) + "\n";
+  // a few rare symbols get long codes
+  for (int i = 1; i < 256; i += 17)
+    _text += (char)i;
+  std::vector<unsigned long long> _freqs(256);
+  for (size_t i = 0; i < _text.size(); i++)
+    _freqs[(unsigned char)_text[i]]++;
+  tbd::HuffmanCode _code;
+  _code.build(&_freqs[0],_freqs.size(),_maxLength);
+  check(_code.maxLength() <= _maxLength, "maxLength()");
+  tbd::MemStream<> _ms;
+  {
+    tbd::BitOStream<tbd::MemStream<> > _bos(_ms);
+    _code.write(_bos);
+    _code.putn(_bos,(const unsigned char*)_text.data(),_text.size());
+    _bos.flush(false);
+  }
+  std::cout << "       " << _text.size() << " -> " << _ms.size() << " bytes" << std::endl;
+  check(_ms.size() < _text.size()*2/3, "compressed");
+  std::string _decoded(_text.size(),0);
+  {
+    tbd::BitIStream<tbd::MemStream<> > _bis(_ms);
+    tbd::HuffmanCode _read;
+    _read.read(_bis);
+    _read.getn(_bis,(unsigned char*)&_decoded[0],_decoded.size());
+    _bis.align();
+  }
+  check(_decoded == _text, "decoded with BitIStream");
+  _decoded.assign(_text.size(),0);
+  tbd::BitMemIStream<> _bmis(_ms.buffer(),_ms.size());
+  tbd::HuffmanCode _read;
+  _read.read(_bmis);
+  _read.getn(_bmis,(unsigned char*)&_decoded[0],_decoded.size());
+  check(_decoded == _text, "decoded with BitMemIStream");
+}
+
+int main()
+{
+  text(tbd::HuffmanCode::MAX_LENGTH);
+  // codes longer than the lookup table
+  text(15);
+  // all codes limited to the table
+  text(tbd::HuffmanCode::TABLE_BITS);
+  std::cout << "single symbol" << std::endl;
+  {
+    std::vector<unsigned int> _freqs(4);
+    _freqs[2] = 10;
+    tbd::HuffmanCode _code;
+    _code.build(&_freqs[0],_freqs.size());
+    check(1 == _code.length(2) && 0 == _code.length(0), "one bit code");
+  }
+  return _failed;
+}
@@ -0,0 +1,91 @@
+#include <iostream>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "tbd/memstream.h"
+
+using namespace std;
+
+static int _failed = 0;
+
+void check(bool _ok, const char* _what)
+{
+  std::cout << (_ok ? "ok     " : "FAILED ") << _what << std::endl;
+  if (!_ok)
+    _failed++;
+}
+
+typedef tbd::MemOStream<> MemOStream;
+
+// many small writes with every growth policy and allocation mode
+void growth(MemOStream::GrowthPolicy _growth, MemOStream::AllocMode _alloc)
+{
+  std::cout << (MemOStream::GP_GEOMETRIC == _growth ? "geometric" : "linear")
+            << (MemOStream::AM_MALLOC == _alloc ? " realloc" : " new") << std::endl;
+  MemOStream _os(1024,0,_growth,_alloc);
+  char _ach[37];
+  for (int i = 0; i < 37; i++)
+    _ach[i] = (char)i;
+  const size_t _count = 100000;
+  for (size_t i = 0; i < _count; i++)
+    _os.write(_ach,sizeof(_ach));
+  check(_os.size() == _count*sizeof(_ach) && _os.reserved() >= _os.size(), "size() and reserved()");
+  check(0 == memcmp(_os.buffer()+sizeof(_ach)*(_count-1),_ach,sizeof(_ach)), "content");
+  _os.seekp(10);
+  _os.write("x",1);
+  check(_os.size() == _count*sizeof(_ach) && _os.buffer()[10] == 'x', "overwrite after seekp()");
+  std::pair<char*,size_t> _detached = _os.detach();
+  check(_detached.second == _count*sizeof(_ach), "detach()");
+  MemOStream::deallocate(_detached.first,_os.alloc());
+  _os.write("ab",2);
+  check(_os.size() == 2 && _os.buffer()[1] == 'b', "reuse after detach()");
+}
+
+int main()
+{
+  growth(MemOStream::GP_LINEAR,MemOStream::AM_NEW);
+  growth(MemOStream::GP_LINEAR,MemOStream::AM_MALLOC);
+  growth(MemOStream::GP_GEOMETRIC,MemOStream::AM_NEW);
+  growth(MemOStream::GP_GEOMETRIC,MemOStream::AM_MALLOC);
+  std::cout << "reserve" << std::endl;
+  {
+    MemOStream _os;
+    _os.reserve(100000);
+    check(_os.reserved() >= 100000, "reserved()");
+    char* p = _os.buffer();
+    for (int i = 0; i < 1000; i++)
+      _os.write("0123456789",10);
+    check(p == _os.buffer(), "no relocation within the reserve");
+  }
+  std::cout << "segmented" << std::endl;
+  {
+    tbd::SegmentedOStream<> _os(1000);
+    std::string _content;
+    for (int i = 0; i < 1000; i++)
+    {
+      const std::string _line = std::to_string(i) + "\n";
+      _os.write(_line.data(),_line.size());
+      _content += _line;
+    }
+    check(_os.size() == _content.size(), "size()");
+    std::vector<tbd::iovec> _iov;
+    const size_t _segments = _os.segments(_iov);
+    check(_segments == _iov.size() && _segments == (_content.size()+999)/1000, "segments()");
+    const void* _firstBase = _iov[0].iov_base;
+    _os.seekp(998);
+    _os.write("<>",2);
+    _content.replace(998,2,"<>");
+    _os.seekp2end();
+    std::pair<char*,size_t> _flat = _os.flatten();
+    check(_flat.second == _content.size() && 0 == memcmp(_flat.first,_content.data(),_flat.second), "back patched across segments");
+    delete[] _flat.first;
+    MemOStream _copy;
+    _os.writeTo(_copy);
+    check(_copy.size() == _content.size() && 0 == memcmp(_copy.buffer(),_content.data(),_content.size()), "writeTo()");
+    _os.segments(_iov);
+    check(_iov[0].iov_base == _firstBase, "segments never move");
+    _os.reset();
+    check(_os.empty(), "reset()");
+  }
+  return _failed;
+}
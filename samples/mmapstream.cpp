@@ -0,0 +1,64 @@
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include "tbd/mmapstream.h"
+#include "tbd/filestream.h"
+
+using namespace std;
+
+static int _failed = 0;
+
+void check(bool _ok, const char* _what)
+{
+  std::cout << (_ok ? "ok     " : "FAILED ") << _what << std::endl;
+  if (!_ok)
+    _failed++;
+}
+
+const char* _fileName = "mmapstream_sample.tmp";
+
+int main()
+{
+  {
+    tbd::FileOStream _os(_fileName);
+    for (int i = 0; i < 1000; i++)
+      _os.put(i);
+  }
+  {
+    tbd::MmapIStream _is(_fileName);
+    check(_is.is_open(), "open()");
+    check(_is.size() == 1000*sizeof(int), "size()");
+    bool _ok = true;
+    for (int i = 0; i < 1000 && _ok; i++)
+    {
+      int n = -1;
+      _is.get(n);
+      _ok = n == i && !_is.fail();
+    }
+    check(_ok, "read the mapped file");
+    _is.seekg(10*sizeof(int));
+    int n = -1;
+    _is.get(n);
+    check(n == 10, "seekg()");
+    _is.seekg2end();
+    check(_is.peek() == -1 && _is.fail(), "peek() at the end fails");
+    char _ach[8];
+    _is.seekg(_is.size()-2);
+    _is.read(_ach,sizeof(_ach));
+    check(_is.gcount() == 2, "short read at the end");
+  }
+  {
+    tbd::FileOStream _os(_fileName);
+  }
+  {
+    tbd::MmapIStream _is(_fileName);
+    check(_is.is_open() && 0 == _is.size(), "empty file");
+    check(_is.peek() == -1, "nothing to read");
+  }
+  std::remove(_fileName);
+  {
+    tbd::MmapIStream _is;
+    check(!_is.open(_fileName) && !_is.is_open(), "missing file");
+  }
+  return _failed;
+}
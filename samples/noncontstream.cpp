@@ -0,0 +1,149 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include "tbd/noncontstream.h"
+#include "tbd/filestream.h"
+#include "tbd/mmapstream.h"
+
+using namespace std;
+
+static int _failed = 0;
+
+void check(bool _ok, const char* _what)
+{
+  std::cout << (_ok ? "ok     " : "FAILED ") << _what << std::endl;
+  if (!_ok)
+    _failed++;
+}
+
+const char* _fileName = "noncontstream_sample.tmp";
+const char* _saveName = "noncontstream_sample2.tmp";
+
+// save() of memory blocks and of file blocks (copied inside the kernel)
+void save()
+{
+  std::cout << "save" << std::endl;
+  {
+    tbd::NonContIStream<tbd::MemIStream<size_t> > _nc;
+    _nc.insert("abcd",0,4);
+    _nc.insert("efgh",6,10);
+    tbd::NonContIStream<tbd::MemIStream<size_t> >::Gaps _gaps;
+    tbd::MemOStream<size_t> _os;
+    _nc.save(_os,_gaps);
+    check(_os.size() == 10 && 0 == memcmp(_os.buffer(),"abcd",4) && 0 == memcmp(_os.buffer()+6,"efgh",4), "memory blocks");
+    check(_gaps.size() == 1 && _gaps[4] == 6, "gaps");
+  }
+  std::string _content(3<<20,'x');
+  for (size_t i = 0; i < _content.size(); i++)
+    _content[i] = (char)('a'+i%26);
+  {
+    tbd::FileOStream _os(_fileName);
+    _os.write(_content.data(),_content.size());
+  }
+  {
+    tbd::FileIStream _is1(_fileName), _is2(_fileName,4096);
+    tbd::NonContIStream<tbd::FileIStream> _nc;
+    _nc.insert(&_is1,1000,2000000);
+    _nc.insert(&_is2,2500000,3<<20);
+    tbd::NonContIStream<tbd::FileIStream>::Gaps _gaps;
+    tbd::FileOStream _os(_saveName);
+    _nc.save(_os,_gaps);
+    check(_os.tellp() == (3<<20) && _gaps.size() == 2, "file blocks");
+  }
+  {
+    tbd::MmapIStream _saved(_saveName);
+    check(_saved.size() == (3<<20)
+      && 0 == memcmp(_saved.data()+1000,_content.data()+1000,2000000-1000)
+      && 0 == memcmp(_saved.data()+2500000,_content.data()+2500000,(3<<20)-2500000), "saved content");
+  }
+  std::remove(_fileName);
+  std::remove(_saveName);
+}
+
+// lookups among many blocks
+void lookup()
+{
+  std::cout << "lookup" << std::endl;
+  const size_t _blocks = 10000;
+  std::string _content(_blocks*12,'x');
+  for (size_t i = 0; i < _content.size(); i++)
+    _content[i] = (char)('a'+i%26);
+  typedef tbd::NonContIStream<tbd::MemIStream<size_t> > NonContIStream;
+  NonContIStream _nc;
+  // 10 byte blocks with a gap of 2 bytes behind every second block,
+  // inserted back to front
+  for (size_t i = _blocks; i-- > 0; )
+  {
+    const size_t _start = i*12 - (i%2 ? 2 : 0);
+    const size_t _end = i*12 + 10;
+    _nc.insert(_content.data()+_start,_start,_end);
+  }
+  check(_nc.blocks() == _blocks, "blocks()");
+  check(_nc.gaps().size() == _blocks/2-1, "gaps()");
+  bool _ok = true;
+  for (size_t i = 0; i < 100000 && _ok; i++)
+  {
+    const size_t _pos = (i*7919) % _content.size();
+    const bool _covered = _pos%24 < 22;
+    _nc.seekg(_pos);
+    char _ch = 0;
+    _nc.read(&_ch,1);
+    _ok = _covered ? 1 == _nc.gcount() && _ch == _content[_pos] : 0 == _nc.gcount();
+  }
+  check(_ok, "random reads");
+  char _ach[22];
+  _nc.seekg(24*100);
+  _nc.read(_ach,sizeof(_ach));
+  check(sizeof(_ach) == _nc.gcount() && 0 == memcmp(_ach,_content.data()+24*100,sizeof(_ach)), "read across adjacent blocks");
+  _nc.seekg(24*100+22);
+  _nc.jumpg();
+  check(_nc.tellg() == 24*101, "jumpg() over a gap");
+}
+
+char* buffer(size_t _start, size_t _end)
+{
+  char* p = new char[_end-_start];
+  for (size_t i = _start; i < _end; i++)
+    p[i-_start] = (char)(i*7);
+  return p;
+}
+
+// merging of adjacent buffers and the byte budget
+void merge()
+{
+  std::cout << "merge and budget" << std::endl;
+  typedef tbd::AutoNonContIStream<tbd::MemIStream<size_t> > AutoNonContIStream;
+  AutoNonContIStream _nc(~(size_t)0,1000,256);
+  for (size_t i = 0; i < 20; i++)
+    _nc.insert(buffer(i*10,i*10+10),i*10,i*10+10);
+  check(_nc.blocks() == 1 && _nc.statistics().m_merges == 19, "adjacent buffers merged");
+  // overlaps the end, the existing data wins
+  _nc.insert(buffer(195,230),195,230);
+  check(_nc.bytes() == 230, "overlap clipped");
+  char _ach[230];
+  _nc.seekg(0);
+  _nc.read(_ach,sizeof(_ach));
+  bool _ok = sizeof(_ach) == _nc.gcount();
+  for (size_t i = 0; i < sizeof(_ach) && _ok; i++)
+    _ok = _ach[i] == (char)(i*7);
+  check(_ok, "read merged blocks");
+  for (size_t i = 0; i < 100; i++)
+    _nc.insert(buffer(1000+i*20,1000+i*20+10),1000+i*20,1000+i*20+10);
+  check(_nc.bytes() <= 1000 && 0 < _nc.statistics().m_evictions, "oldest blocks dropped by the budget");
+  _nc.seekg(1000+99*20);
+  _nc.read(_ach,10);
+  check(10 == _nc.gcount() && _ach[0] == (char)((1000+99*20)*7), "newest block kept");
+  delete[] _nc.release(1000+99*20);
+  check(_nc.bytes() <= 990, "release()");
+  _nc.clear();
+  check(0 == _nc.bytes(), "clear()");
+}
+
+int main()
+{
+  save();
+  lookup();
+  merge();
+  return _failed;
+}